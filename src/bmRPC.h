@@ -25,13 +25,19 @@
 #include <vector>
 #include <sstream>
 #include <array>
-#include <queue>
 #include <forward_list> // for registry
+#include <functional>   //std::function for callbacks
 #include <charconv>     //from_chars and to_chars
 #include <algorithm>// for godbolt
 #include <chrono> // for godbolt
 #include <cstring> //std::memcpy for godbolt
 #include <climits> //char_bit for godbolt
+#include <limits> //numeric_limits for reserved method ids
+#include <atomic> //SPSC ring transport
+#include <new> //in place client callbacks
+#include <cstddef> //max_align_t for the client callbacks and the coroutine frames
+#include <mutex> //SPSC ring transport wait
+#include <condition_variable> //SPSC ring transport wait
 
 /**
  * User Settings
@@ -69,9 +75,88 @@ constexpr bool to_swap = endian::SRV_NATIVE != endian::CLN_NATIVE;
 //Set the maximum size (sizeof(SIZE_T) of blob types (std::string and std::vector<unsigned char>)
 using SIZE_T = uint16_t;
 
+//Set the RPC method id type (uint8_t or uint16_t).
+//The method id replaces the function prototype on the wire. It is bound once per link by the connect handshake.
+using METHOD_ID_T = uint16_t;
+
+//Set the invokation id type (uint16_t, uint32_t or uint64_t).
+//The invokation id correlates a reply with its pending call: the wider the id, the later a slot generation
+//wraps and a late reply could be matched to a newer call.
+using INVOKATION_ID_T = uint32_t;
+static_assert(std::is_unsigned_v<INVOKATION_ID_T> && sizeof(INVOKATION_ID_T) >= 2, "The invokation id must be uint16_t, uint32_t or uint64_t");
+
+//Set the registry type.
+//The indexed registry stores the connected functions in a contiguous table directly addressed by method id.
+//The hashed registry has no capacity limit, but only its first MAX_REGISTRY_SIZE functions can be bound:
+//the client connect of the others returns an invalid handle.
+#define INDEXED_REGISTRY true
+
+//Set the indexed registry capacity (maximum number of connected functions).
+//It also sizes the server link table: the method ids bound by a client are lower than MAX_REGISTRY_SIZE.
+#define MAX_REGISTRY_SIZE 64
+
 //Set client message buffer buffer size
 #define MAX_CLIENT_MSG_BUFFER_SIZE 512
 
+//Set the message pool size of each server and client.
+//It bounds the number of messages being received, dispatched and transmitted.
+#define MSG_POOL_SIZE (2 * MAX_CLIENT_MSG_BUFFER_SIZE)
+
+//Set the maximum number of client invokations waiting for the reply.
+#define MAX_PENDING_INVOKATIONS (2 * MAX_CLIENT_MSG_BUFFER_SIZE)
+
+//Set the flow control window: the number of calls the server accepts in flight on a link (0: no flow control).
+//The server advertises it in the bind replies and rejects the requests beyond it with a BUSY reply.
+//RpcServer::setWindow changes it at run time: the new window reaches the functions bound afterwards.
+//The client refuses the calls (asyncRPC returns false) while the window is filled by the calls waiting for the reply.
+#define FLOW_CONTROL_WINDOW (MSG_POOL_SIZE / 2)
+
+//Set the default deadline in milliseconds of the client calls (0: no deadline).
+//A call without reply within its deadline is completed with a TIMEOUT status and its late reply is dropped.
+//asyncRPC with an explicit timeout_ms (ASYNC_RPC_WITH_TIMEOUT) overrides it.
+#define CALL_TIMEOUT_MS 0
+
+//Set Heap-less memory mode (binary protocol only).
+//Message payloads, output arguments addresses and the registry are stored in statically sized pools.
+//Exceeding their capacity is reported as a call failure.
+#ifndef HEAP_LESS
+#define HEAP_LESS false
+#endif
+[[maybe_unused]] const bool is_heap_less = HEAP_LESS;
+static_assert(!HEAP_LESS || BINARY_BASED_PROTOCOL, "Heap-less mode requires the binary protocol");
+
+//Set the message payload capacity in heap-less mode.
+#define MAX_MSG_PAYLOAD_SIZE 256
+
+//Set the maximum number of output arguments in heap-less mode.
+#define MAX_OUT_ARGS 8
+
+//Set the maximum number of arguments of a connected function in heap-less mode.
+#define MAX_ARGS 16
+
+//Set the in place storage size in bytes of the client callbacks (at least the size of a std::function).
+//Bigger callbacks are allocated on the heap, they do not compile in heap-less mode.
+#define CALLBACK_STORAGE_SIZE 32
+
+//Set the typed marshalling (binary protocol only): the server decodes the arguments of each connected
+//function in a tuple of its parameter types and encodes the results without the AnyArg boxing.
+//If false the generic, format-driven marshaller is used (smaller code).
+#define TYPED_MARSHALLING true
+[[maybe_unused]] const bool typed_marshalling = TYPED_MARSHALLING;
+
+//Set the vector byte shuffles for the swap of numeric array arguments (vector<short/int/float/double>).
+//SSSE3/AVX2 (x86) or NEON (ARM) are used when enabled by the compiler target flags (e.g. -mavx2), scalar swap otherwise.
+#define SIMD_BYTESWAP true
+
+//Set the compact encoding (binary protocol only): integer arguments and return values, lengths, invokation ids,
+//method ids and message sizes are sent as LEB128 varints, signed values zigzag mapped.
+//Smaller frames for the typical small values at the cost of a variable length decoding.
+#ifndef COMPACT_ENCODING
+#define COMPACT_ENCODING false
+#endif
+[[maybe_unused]] const bool compact_encoding = COMPACT_ENCODING;
+static_assert(!COMPACT_ENCODING || BINARY_BASED_PROTOCOL, "Compact encoding requires the binary protocol");
+
 //Set streamer circular buffer size.
 //Must be a power of two.
 
@@ -79,6 +164,39 @@ using SIZE_T = uint16_t;
 constexpr bool streamer_power_of_2_req = STREAMER_BUFFER_SIZE && !(STREAMER_BUFFER_SIZE & (STREAMER_BUFFER_SIZE - 1));
 static_assert(streamer_power_of_2_req,"The Streamer circular buffer size must be a power of two");
 
+//Set the batching mode (binary protocol only): the messages queued for transmission within a loop
+//are coalesced into one batch frame of at most MAX_BATCH_SIZE bytes.
+#ifndef BATCHING
+#define BATCHING false
+#endif
+#define MAX_BATCH_SIZE 1024
+static_assert(!BATCHING || BINARY_BASED_PROTOCOL, "Batching requires the binary protocol");
+
+//Set the number of server worker threads running the registered functions.
+//0: single-threaded server, the functions run in doLoop (bare-metal builds).
+//The registered functions must be thread-safe when more than one worker is used.
+//A function is not disconnected while the workers run its calls (RpcServer::disconnect returns false).
+#ifndef SERVER_WORKERS
+#define SERVER_WORKERS 0
+#endif
+
+//Set the SPSC ring transport capacity of each direction (a power of two).
+#define SPSC_RING_SIZE 4096
+static_assert(SPSC_RING_SIZE && !(SPSC_RING_SIZE & (SPSC_RING_SIZE - 1)),"The SPSC ring size must be a power of two");
+
+//Set the readiness-driven loop: doLoop processes the data ready on the link and returns
+//instead of polling the link for SERVER_LOOP_TOUT_MS/CLIENT_LOOP_TOUT_MS.
+//Use the server/client wait() to sleep until the link has data.
+#define EVENT_DRIVEN_LOOP true
+
+//Set the C++20 coroutine client API: co_await client.CALL_RPC(f, handle, args...) yields a Result<R>.
+//It is compiled only by a C++20 compiler (__cpp_impl_coroutine), the callback API is always available.
+#define COROUTINES true
+
+//Set the number and the size in bytes of the statically allocated coroutine frames.
+#define MAX_COROUTINES 16
+#define COROUTINE_FRAME_SIZE 512
+
 /**
  * System Settings
  */
@@ -93,17 +211,46 @@ static_assert(streamer_power_of_2_req,"The Streamer circular buffer size must be
 #define INLINE
 #endif
 
+//Server argument scratch buffers are reused across the calls: one set per worker thread.
+#if SERVER_WORKERS > 0
+#define SCRATCH_STORAGE static thread_local
+#else
+#define SCRATCH_STORAGE static
+#endif
+
+
+#if COROUTINES && defined(__cpp_impl_coroutine)
+#define BMRPC_COROUTINES true
+#include <coroutine>
+#else
+#define BMRPC_COROUTINES false
+#endif
+
+#if SIMD_BYTESWAP
+#if defined(__SSSE3__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#endif
+
+#if SERVER_WORKERS > 0
+#include <thread>
+#endif
 
 #include "bmRPCUtilities.h"
 #include "bmRPCDataLink.h"
 #include "bmRPCStreamer.h"
 #include "bmRPCTimeout.h"
+#include "bmRPCPool.h"
 #include "bmRPCMessage.h"
 #include "bmRPCSerializer.h"
 #include "bmRPCAnyArg.h"
 #include "bmRPCMarshaller.h"
 #include "bmRPCStub.h"
 #include "bmRPCRegistry.h"
+#include "bmRPCWorkers.h"
+#include "bmRPCCoroutine.h"
 #if BMRPC_SERVER
     #include "bmRPCServer.h"
 #endif
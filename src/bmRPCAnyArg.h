@@ -24,33 +24,133 @@ namespace bm
 {
 namespace rpc
 {
+    //Numeric array argument types (binary protocol): swapped in bulk
+    template<typename T>
+    struct is_array_arg : std::false_type {};
+#if BINARY_BASED_PROTOCOL
+    template<>
+    struct is_array_arg<std::vector<short>> : std::true_type {};
+    template<>
+    struct is_array_arg<std::vector<int>> : std::true_type {};
+    template<>
+    struct is_array_arg<std::vector<float>> : std::true_type {};
+#if P64
+    template<>
+    struct is_array_arg<std::vector<double>> : std::true_type {};
+#endif
+#endif
+    template<typename T>
+    constexpr bool is_array_arg_v = is_array_arg<T>::value;
+
+    /**
+     * array_view
+     * Read-only view of a numeric array argument passed by value (binary protocol).
+     * On the server the view may point directly into the received payload: it is valid during the call only.
+     * It also refers to the constexpr format tables of the connected functions.
+     */
+    template<typename T>
+    class array_view {
+    public:
+        using value_type = T;
+        using const_iterator = const T*;
+
+        constexpr array_view() : m_data(nullptr), m_size(0) {}
+        constexpr array_view(const T *data, size_t size) : m_data(data), m_size(size) {}
+        array_view(const std::vector<T> &v) : m_data(v.data()), m_size(v.size()) {}
+        template<size_t N>
+        constexpr array_view(const std::array<T, N> &a) : m_data(a.data()), m_size(N) {}
+
+        [[nodiscard]] INLINE constexpr const T *data() const { return m_data; }
+        [[nodiscard]] INLINE constexpr size_t size() const { return m_size; }
+        [[nodiscard]] INLINE constexpr bool empty() const { return m_size == 0; }
+        INLINE constexpr const T &operator[](size_t ix) const { return m_data[ix]; }
+        INLINE constexpr const_iterator begin() const { return m_data; }
+        INLINE constexpr const_iterator end() const { return m_data + m_size; }
+
+    private:
+        const T *m_data;
+        size_t m_size;
+    };
+
+    template<typename T>
+    struct is_array_view : std::false_type {};
+    template<typename T>
+    struct is_array_view<array_view<T>> : is_array_arg<std::vector<T>> {};
+    template<typename T>
+    constexpr bool is_array_view_v = is_array_view<T>::value;
+
     namespace stream {
         /**
          * Endianess
          */
 
-        //Static swap
-        template<class T, std::size_t... N>
-        constexpr T sta_byteswap_impl(T i, std::index_sequence<N...>) {
-            return (((i >> N * CHAR_BIT & std::uint8_t(-1)) << (sizeof(T) - 1 - N) * CHAR_BIT) | ...);
-        }
-
-        template<class T, class U = std::make_unsigned_t<T>>
-        void sta_byteswap(T &i) {
-            i = sta_byteswap_impl<U>(i, std::make_index_sequence<sizeof(T)>{});
+        //Swap with the compiler intrinsics. Floating-point values are swapped through their integer representation.
+        template<typename T>
+        INLINE void byteswap(T &value) {
+            if constexpr(sizeof(T) == 2) {
+                uint16_t u;
+                std::memcpy(&u, &value, sizeof(T));
+                u = __builtin_bswap16(u);
+                std::memcpy(&value, &u, sizeof(T));
+            } else if constexpr(sizeof(T) == 4) {
+                uint32_t u;
+                std::memcpy(&u, &value, sizeof(T));
+                u = __builtin_bswap32(u);
+                std::memcpy(&value, &u, sizeof(T));
+            } else if constexpr(sizeof(T) == 8) {
+                uint64_t u;
+                std::memcpy(&u, &value, sizeof(T));
+                u = __builtin_bswap64(u);
+                std::memcpy(&value, &u, sizeof(T));
+            }
         }
 
-        //Dynamic swap
-        template<typename T>
-        void dyn_byteswap(T &value) {
-            union U {
-                T value;
-                unsigned char raw[sizeof(T)];
-            } src{}, dst{};
-            src.value = value;
-            dst.value = 0;
-            std::reverse_copy(src.raw, src.raw + sizeof(T), dst.raw);
-            value = dst.value;
+        //Byte shuffle mask reversing each S bytes element of a 16 bytes vector
+        template<size_t S>
+        struct SwapMask {
+            alignas(16) unsigned char bytes[16];
+            constexpr SwapMask() : bytes() {
+                for (size_t j = 0; j < 16; ++j)
+                    bytes[j] = (unsigned char)((j / S) * S + (S - 1 - j % S));
+            }
+        };
+
+        //Swap of n elements of S bytes stored at p (any alignment).
+        //The vector shuffles enabled by the target flags process the bulk, the tail is swapped one element at a time.
+        template<size_t S>
+        void byteswap_array(unsigned char *p, size_t n) {
+            static_assert(S == 2 || S == 4 || S == 8, "Unsupported element size");
+            size_t i = 0;
+#if SIMD_BYTESWAP && (defined(__SSSE3__) || defined(__AVX2__))
+            static constexpr SwapMask<S> mask{};
+            const __m128i mask128 = _mm_load_si128(reinterpret_cast<const __m128i *>(mask.bytes));
+#if defined(__AVX2__)
+            const __m256i mask256 = _mm256_broadcastsi128_si256(mask128);//the shuffle works on 128 bits lanes
+            for (; i + 32 / S <= n; i += 32 / S) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i * S));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + i * S), _mm256_shuffle_epi8(v, mask256));
+            }
+#endif
+            for (; i + 16 / S <= n; i += 16 / S) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i * S));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(p + i * S), _mm_shuffle_epi8(v, mask128));
+            }
+#elif SIMD_BYTESWAP && defined(__ARM_NEON)
+            for (; i + 16 / S <= n; i += 16 / S) {
+                uint8x16_t v = vld1q_u8(p + i * S);
+                if constexpr(S == 2) v = vrev16q_u8(v);
+                else if constexpr(S == 4) v = vrev32q_u8(v);
+                else v = vrev64q_u8(v);
+                vst1q_u8(p + i * S, v);
+            }
+#endif
+            using UI = std::conditional_t<S == 2, uint16_t, std::conditional_t<S == 4, uint32_t, uint64_t>>;
+            for (; i < n; ++i) {
+                UI u;
+                std::memcpy(&u, p + i * S, S);
+                byteswap(u);
+                std::memcpy(p + i * S, &u, S);
+            }
         }
 
         /**
@@ -64,63 +164,105 @@ namespace rpc
 #endif
         }
 
+        //Text encoding of a token, formatted as the default ostream does (floating-point: 6 significant digits).
+        template<typename T>
+        void write_text(std::string &s, const T &data) {
+            if constexpr(std::is_same_v<T, std::string>) {
+                s.append(data);
+            } else if constexpr(std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>) {
+                s.push_back((char) data);
+            } else {
+                char buf[32];
+                std::to_chars_result r{};
+                if constexpr(std::is_same_v<T, bool>)
+                    r = std::to_chars(buf, buf + sizeof(buf), (int) data);
+                else if constexpr(std::is_floating_point_v<T>)
+                    r = std::to_chars(buf, buf + sizeof(buf), data, std::chars_format::general, 6);
+                else
+                    r = std::to_chars(buf, buf + sizeof(buf), data);
+                s.append(buf, r.ptr);
+            }
+        }
+
+        //Text payload: space separated tokens appended to s, which keeps its capacity.
         template<typename T>
-        void write(std::ostringstream &s, T data) {
-            s << " ";//delimeter
+        void write(std::string &s, T data) {
+            if (!s.empty())
+                s.push_back(' ');//delimiter
             if constexpr(std::is_pointer_v<T>)
-                s << *data;
+                write_text(s, *data);
             else
-                s << data;
+                write_text(s, data);
         }
 
+        //Bulk append of n bytes.
+        template<typename B>
+        INLINE void append(B &s, const void *p, size_t n) {
+            auto first = static_cast<const unsigned char *>(p);
+            s.insert(s.end(), first, first + n);
+        }
+
+        //Integers sent as varints in compact encoding
         template<typename T>
-        void write(std::vector<unsigned char> &s, T data) {
+        constexpr bool is_varint_v = COMPACT_ENCODING && std::is_integral_v<T> && sizeof(T) > 1;
+
+        //Length prefix of blobs and arrays
+        template<typename B>
+        INLINE void write_length(B &s, SIZE_T length) {
+            if constexpr(COMPACT_ENCODING) {
+                unsigned char buf[MAX_VARINT_SIZE];
+                append(s, buf, encode_varint(buf, length));
+            } else {
+                if constexpr(to_swap) { byteswap(length); }
+                append(s, &length, sizeof(SIZE_T));
+            }
+        }
+
+        //Binary encoding shared by the payload types.
+        template<typename B, typename T>
+        void write_binary(B &s, T data) {
             if constexpr(std::is_pointer_v<std::remove_cv_t<T>>) {
-                SIZE_T n;
                 using t = typename remove_all<T>::type;
-                const unsigned char *p_src;
                 if constexpr(std::is_same_v<t, std::string> || std::is_same_v<t, std::vector<unsigned char>>) {
-                    SIZE_T length = n = data->size();
-
-                    if constexpr(to_swap) { sta_byteswap(length); }
-
-                    p_src = reinterpret_cast<const unsigned char *>(&length);
-                    s.push_back(*p_src++);
-                    s.push_back(*p_src);
-                    if constexpr(std::is_same_v<t, std::string>)
-                        p_src = reinterpret_cast<const unsigned char *>(data->c_str());//null terminated string
-                    else
-                        p_src = reinterpret_cast<const unsigned char *>(data->data());
-                    for (int i = 0; i < n; i++, p_src++) {
-                        s.push_back(*p_src);
-                    }
+                    write_length(s, data->size());
+                    append(s, data->data(), data->size());
+                } else if constexpr(is_array_arg_v<t> || is_array_view_v<t>) {
+                    constexpr size_t S = sizeof(typename t::value_type);
+                    write_length(s, data->size());//elements
+                    size_t offset = s.size();
+                    append(s, data->data(), data->size() * S);
+                    if constexpr(to_swap) { byteswap_array<S>(s.data() + offset, (s.size() - offset) / S); }
                 } else {
-                    n = sizeof(t);
-                    p_src = reinterpret_cast<const unsigned char *>(data) + n - 1;
-                    for (int i = n; i > 0; --i, --p_src) {
-                        s.push_back(*p_src);
-                    }
+                    write_binary(s, t(*data));
                 }
+            } else if constexpr(is_array_view_v<T>) {
+                write_binary(s, &data);
             } else {
-                if constexpr(std::is_same_v<T, char> || std::is_same_v<T, bool>) {
+                if constexpr(sizeof(T) == 1) {
                     s.push_back(data);
+                } else if constexpr(is_varint_v<T>) {
+                    //the signed representation is used for both signedness: they share the encoding
+                    unsigned char buf[MAX_VARINT_SIZE];
+                    append(s, buf, encode_varint(buf, zigzag(std::make_signed_t<T>(data))));
                 } else {
-                    if constexpr(to_swap) {
-                        if constexpr(std::is_same_v<T, float> || std::is_same_v<T, double>)
-                            dyn_byteswap(data);
-                        else
-                            sta_byteswap(data);
-                    }
-
-                    auto p_src = reinterpret_cast<const unsigned char *>(&data);
-                    for (int i = 0; i < sizeof(T); ++i, ++p_src) {
-                        s.push_back(*p_src);
-                    }
+                    if constexpr(to_swap) { byteswap(data); }
+                    append(s, &data, sizeof(T));
                 }
-
             }
         }
 
+        template<typename T>
+        INLINE void write(std::vector<unsigned char> &s, T data) {
+            write_binary(s, data);
+        }
+
+#if HEAP_LESS
+        template<typename T>
+        INLINE void write(Payload &s, T data) {
+            write_binary(s, data);
+        }
+#endif
+
 
         /**
         * Read
@@ -133,72 +275,114 @@ namespace rpc
 #endif
         }
 
+        //Text decoding of a token in place.
+        //The from_chars overloads for floating-point types require libstdc++ 11 or later.
         template<typename T>
-        inline void read(std::string s, T &data) {
-            if constexpr(std::is_same_v<T, float>) {
-                //stof is used in place of from_chars because the overloads for floating-point types
-                //is missing in some libstdcc++ (https://gcc.gnu.org/pipermail/gcc-patches/2020-July/550331.html).
-                //To be fixed in the future as stof can be roughly 3x slower than from_chars.
-                //std::from_chars(str.data(), str.data() + str.size(), fconv) ;
-                data = stof(s);
-            } else if constexpr(std::is_same_v<T, double>) {
-                //same as stof
-                data = stod(s);
-            } else if constexpr(std::is_same_v<T, char>) {
-                data = s.c_str()[0];
+        inline void read(std::string_view s, T &data) {
+            if constexpr(std::is_same_v<T, char>) {
+                data = s.empty() ? '\0' : s[0];
             } else if constexpr(std::is_same_v<T, std::string>) {
-                data = s;
+                data.assign(s);
             } else
                 std::from_chars(s.data(), s.data() + s.size(), data);
         }
 
 
+        //Decodes the length prefix of blobs and arrays from at most n bytes at s. Returns the decoded size, 0 when truncated.
+        INLINE size_t read_length(const unsigned char *s, size_t n, SIZE_T &length) {
+            if constexpr(COMPACT_ENCODING) {
+                return decode_varint(s, n, length);
+            } else {
+                if (n < sizeof(SIZE_T)) {
+                    length = 0;
+                    return 0;
+                }
+                std::memcpy(&length, s, sizeof(SIZE_T));
+#ifdef LOOP_BACK_TEST
+                if constexpr(to_swap) { byteswap(length); }
+#endif
+                return sizeof(SIZE_T);
+            }
+        }
+
+        //Binary decoding from at most n bytes at s. Returns the decoded size, 0 when truncated.
         template<typename T>
-        void read(std::vector<unsigned char>::iterator s, T &data) {
+        size_t read(const unsigned char *s, size_t n, T &data) {
             if constexpr(std::is_same_v<T, std::string> || std::is_same_v<T, std::vector<unsigned char>>) {
-                SIZE_T size;
-                auto p = reinterpret_cast<unsigned char *>(&size);
-                *p++ = *s++;
-                *p = *s++;
+                SIZE_T size = 0;
+                size_t k = read_length(s, n, size);
+                if (k == 0 || n - k < size)
+                    return 0;
+                data.insert(data.end(), s + k, s + k + size);
+                return k + size;
+            } else if constexpr(is_array_arg_v<T>) {
+                constexpr size_t S = sizeof(typename T::value_type);
+                SIZE_T size = 0;
+                size_t k = read_length(s, n, size);
+                if (k == 0 || (n - k) / S < size)
+                    return 0;
+
+                size_t offset = data.size();
+                data.resize(offset + size);
+                std::memcpy(data.data() + offset, s + k, size * S);
 
 #ifdef LOOP_BACK_TEST
-                if constexpr(to_swap) { sta_byteswap(size); }
+                if constexpr(to_swap) { byteswap_array<S>(reinterpret_cast<unsigned char *>(data.data() + offset), size); }
 #endif
-
-                std::copy(s, s + size, std::back_inserter(data));
+                return k + size * S;
             } else {
-                if constexpr(std::is_same_v<T, char> || std::is_same_v<T, bool>) {
-                    data = *s;
+                if constexpr(is_varint_v<T>) {
+                    std::make_unsigned_t<T> u{};
+                    size_t k = decode_varint(s, n, u);
+                    data = T(unzigzag(u));
+                    return k;
                 } else {
-                    auto p_data = reinterpret_cast<unsigned char *>(&data);
-                    for (int i = 0; i < sizeof(T); i++, p_data++) {
-                        *p_data = s[i];
+                    if (n < sizeof(T)) {
+                        data = T();
+                        return 0;
                     }
+                    if constexpr(std::is_same_v<T, char> || std::is_same_v<T, bool>) {
+                        data = *s;
+                        return sizeof(T);
+                    } else {
+                        std::memcpy(&data, s, sizeof(T));
 
 #ifdef LOOP_BACK_TEST
-                    if constexpr(to_swap) {
-                        if constexpr(std::is_same_v<T, float> || std::is_same_v<T, double>) { dyn_byteswap(data); }
-                        else { sta_byteswap(data); }
-                    }
+                        if constexpr(to_swap) { byteswap(data); }
 #endif
+                        return sizeof(T);
+                    }
                 }
             }
         }
 
-        template<typename T>
-        void read(std::vector<unsigned char> s, T &data) {
-            auto p_data = reinterpret_cast<unsigned char *>(&data);
-            auto p = s.data();
-            for (int i = 0; i < sizeof(T); i++, p_data++) {
-                *p_data = p[i];
-            }
-
+        //Reads an array as a view from at most n bytes at s. The view points into s when the elements need no swap
+        //and are aligned, otherwise into copy. Returns the decoded size, 0 when truncated.
+        template<typename E>
+        size_t read(const unsigned char *s, size_t n, array_view<E> &view, std::vector<E> &copy) {
+            SIZE_T size = 0;
+            size_t k = read_length(s, n, size);
+            if (k == 0 || (n - k) / sizeof(E) < size)
+                return 0;
 #ifdef LOOP_BACK_TEST
-            if constexpr(to_swap) {
-                if constexpr(std::is_same_v<T, float> || std::is_same_v<T, double>) { dyn_byteswap(data); }
-                else { sta_byteswap(data); }
-            }
+            constexpr bool swapped = to_swap;
+#else
+            constexpr bool swapped = false;
 #endif
+            const unsigned char *p = s + k;
+            if (!swapped && reinterpret_cast<uintptr_t>(p) % alignof(E) == 0) {
+                view = array_view<E>(reinterpret_cast<const E *>(p), size);//zero copy
+            } else {
+                copy.clear();
+                read(s, n, copy);
+                view = array_view<E>(copy.data(), copy.size());
+            }
+            return k + size * sizeof(E);
+        }
+
+        template<typename T>
+        INLINE size_t read(unsigned char *s, size_t n, T &data) {
+            return read(static_cast<const unsigned char *>(s), n, data);
         }
     }//namespace stream
 
@@ -255,6 +439,15 @@ namespace rpc
         STRING_REF,//string& by reference
 #if BINARY_BASED_PROTOCOL
         BLOB_REF,//vector<unsigned char>& by reference
+        CONST_SHORT_ARRAY_REF,//const vector<short>& by reference
+        CONST_INT_ARRAY_REF,//const vector<int>& by reference
+        CONST_FLOAT_ARRAY_REF,//const vector<float>& by reference
+        SHORT_ARRAY_REF,//vector<short>& by reference
+        INT_ARRAY_REF,//vector<int>& by reference
+        FLOAT_ARRAY_REF,//vector<float>& by reference
+        SHORT_VIEW,//array_view<short> by value
+        INT_VIEW,//array_view<int> by value
+        FLOAT_VIEW,//array_view<float> by value
 #endif
         VOID// function with no return value
     };
@@ -269,6 +462,9 @@ namespace rpc
         STRING_REF,//string& by reference
 #if BINARY_BASED_PROTOCOL
         BLOB_REF,//vector<unsigned char>& by reference
+        SHORT_ARRAY_REF,//vector<short>& by reference
+        INT_ARRAY_REF,//vector<int>& by reference
+        FLOAT_ARRAY_REF,//vector<float>& by reference
 #endif
         VOID// function with no return value
     };
@@ -306,13 +502,27 @@ namespace rpc
         STRING_REF,//string& by reference
 #if BINARY_BASED_PROTOCOL
         BLOB_REF,//vector<unsigned char>& by reference
+        CONST_SHORT_ARRAY_REF,//const vector<short>& by reference
+        CONST_INT_ARRAY_REF,//const vector<int>& by reference
+        CONST_FLOAT_ARRAY_REF,//const vector<float>& by reference
+        SHORT_ARRAY_REF,//vector<short>& by reference
+        INT_ARRAY_REF,//vector<int>& by reference
+        FLOAT_ARRAY_REF,//vector<float>& by reference
+        SHORT_VIEW,//array_view<short> by value
+        INT_VIEW,//array_view<int> by value
+        FLOAT_VIEW,//array_view<float> by value
 #endif
         VOID, // function with no return value
         LONGLONG,//long long by value
         ULONGLONG,//unsigned long long by value
         LONGLONG_REF,//unsigned long long by reference
         DOUBLE,//double by value
-        DOUBLE_REF//double by reference
+        DOUBLE_REF,//double by reference
+#if BINARY_BASED_PROTOCOL
+        CONST_DOUBLE_ARRAY_REF,//const vector<double>& by reference
+        DOUBLE_ARRAY_REF,//vector<double>& by reference
+        DOUBLE_VIEW//array_view<double> by value
+#endif
     };
 
     //Output Argument types
@@ -324,10 +534,16 @@ namespace rpc
         STRING_REF,//string& by reference
 #if BINARY_BASED_PROTOCOL
         BLOB_REF,//vector<unsigned char>& by reference
+        SHORT_ARRAY_REF,//vector<short>& by reference
+        INT_ARRAY_REF,//vector<int>& by reference
+        FLOAT_ARRAY_REF,//vector<float>& by reference
 #endif
         VOID,// function with no return value
         LONGLONG_REF,//long long by reference
-        DOUBLE_REF//double by reference
+        DOUBLE_REF,//double by reference
+#if BINARY_BASED_PROTOCOL
+        DOUBLE_ARRAY_REF//vector<double>& by reference
+#endif
     };
 
     //Return Values types
@@ -398,6 +614,10 @@ namespace rpc
                 return (blob *) val.p;
             else if constexpr(std::is_same<T, const blob *>::value)
                 return (const blob *) val.p;
+            else if constexpr(is_array_arg_v<typename remove_all<T>::type>)
+                return *(std::remove_reference_t<T> *) val.p;
+            else if constexpr(is_array_view_v<T>)
+                return *(T *) val.p;
 #endif
             else if constexpr(std::is_same<T, void *>::value)
                 return (void *) val.p;
@@ -434,6 +654,10 @@ namespace rpc
                 blob *p_str = reinterpret_cast<T>(val.p);
                 stream::write(s, p_str);
             }
+            else if constexpr(is_array_arg_v<typename remove_all<T>::type>) {
+                T p_arr = reinterpret_cast<T>(val.p);
+                stream::write(s, p_arr);
+            }
 #endif
 #if P64
             else if constexpr(std::is_same<T, long long>::value || std::is_same<T, unsigned long long>::value)
@@ -448,22 +672,43 @@ namespace rpc
         U val{};
     };
 
+    //Outcome of a client call reported to its callback.
+    enum class CallStatus : uint8_t {
+        OK,       //the reply has been received
+        TIMEOUT,  //no reply before the call deadline: the output arguments are not written
+        REJECTED, //the server flow control rejected the call, or the client could not send it: it has not been executed
+        INVALID   //the reply could not be decoded
+    };
+
     class ReturnValue {
     public:
 
         explicit ReturnValue() :
                 m_valid(false),
                 m_type(RArgTypeId::WRONG),
-                m_value(AnyArg()) {};
+                m_value(AnyArg()),
+                m_status(CallStatus::OK) {};
 
         explicit ReturnValue(bool valid, RArgTypeId type, AnyArg value) :
                 m_valid(valid),
                 m_type(type),
-                m_value(value) {};
+                m_value(value),
+                m_status(CallStatus::OK) {};
+
+        //Invalid return value of a call without reply.
+        explicit ReturnValue(CallStatus status) :
+                m_valid(false),
+                m_type(RArgTypeId::WRONG),
+                m_value(AnyArg()),
+                m_status(status) {};
 
 
         [[nodiscard]] INLINE bool valid() const { return m_valid; }
 
+        [[nodiscard]] INLINE CallStatus status() const { return m_status; }
+
+        [[nodiscard]] INLINE bool timed_out() const { return m_status == CallStatus::TIMEOUT; }
+
         template<typename T>
         INLINE auto get_value() { return m_value.getAs<T>(); }
 
@@ -473,6 +718,52 @@ namespace rpc
         bool m_valid;
         RArgTypeId m_type;
         AnyArg m_value;
+        CallStatus m_status;
+    };
+
+    /**
+     * Result
+     * Typed outcome of a call: the return value of type R when ok(), the call status otherwise.
+     */
+
+    template<typename R>
+    class Result {
+    public:
+
+        explicit Result(CallStatus status = CallStatus::INVALID) :
+                m_value(),
+                m_status(status) {};
+
+        explicit Result(R value) :
+                m_value(value),
+                m_status(CallStatus::OK) {};
+
+        [[nodiscard]] INLINE bool ok() const { return m_status == CallStatus::OK; }
+
+        [[nodiscard]] INLINE CallStatus status() const { return m_status; }
+
+        [[nodiscard]] INLINE const R& value() const { return m_value; }
+
+        [[nodiscard]] INLINE R value_or(R other) const { return ok() ? m_value : other; }
+
+    private:
+        R m_value;
+        CallStatus m_status;
+    };
+
+    template<>
+    class Result<void> {
+    public:
+
+        explicit Result(CallStatus status = CallStatus::OK) :
+                m_status(status) {};
+
+        [[nodiscard]] INLINE bool ok() const { return m_status == CallStatus::OK; }
+
+        [[nodiscard]] INLINE CallStatus status() const { return m_status; }
+
+    private:
+        CallStatus m_status;
     };
 
 
@@ -600,6 +891,48 @@ namespace rpc
     struct ArgType<blob *> {
         static constexpr bool valid = true;
     };
+
+    template<>
+    struct ArgType<std::vector<short>> {
+        static constexpr bool valid = true;
+    };
+
+    template<>
+    struct ArgType<std::vector<int>> {
+        static constexpr bool valid = true;
+    };
+
+    template<>
+    struct ArgType<std::vector<float>> {
+        static constexpr bool valid = true;
+    };
+#if P64
+    template<>
+    struct ArgType<std::vector<double>> {
+        static constexpr bool valid = true;
+    };
+#endif
+
+    template<>
+    struct ArgType<array_view<short>> {
+        static constexpr bool valid = true;
+    };
+
+    template<>
+    struct ArgType<array_view<int>> {
+        static constexpr bool valid = true;
+    };
+
+    template<>
+    struct ArgType<array_view<float>> {
+        static constexpr bool valid = true;
+    };
+#if P64
+    template<>
+    struct ArgType<array_view<double>> {
+        static constexpr bool valid = true;
+    };
+#endif
 #endif
 
     template<>
@@ -860,6 +1193,116 @@ namespace rpc
         static constexpr OutArgTypeId out_id = OutArgTypeId::WRONG;
         static constexpr RArgTypeId r_id = RArgTypeId::WRONG;
     };
+
+    template<>
+    struct ParamType<std::vector<short> &> {
+        static constexpr const char *name = "vector<short>&";
+        static constexpr bool valid = true;
+        static constexpr InArgTypeId in_id = InArgTypeId::SHORT_ARRAY_REF;
+        static constexpr OutArgTypeId out_id = OutArgTypeId::SHORT_ARRAY_REF;
+        static constexpr RArgTypeId r_id = RArgTypeId::WRONG;
+    };
+
+    template<>
+    struct ParamType<const std::vector<short> &> {
+        static constexpr const char *name = "constvector<short>&";
+        static constexpr bool valid = true;
+        static constexpr InArgTypeId in_id = InArgTypeId::CONST_SHORT_ARRAY_REF;
+        static constexpr OutArgTypeId out_id = OutArgTypeId::WRONG;
+        static constexpr RArgTypeId r_id = RArgTypeId::WRONG;
+    };
+
+    template<>
+    struct ParamType<std::vector<int> &> {
+        static constexpr const char *name = "vector<int>&";
+        static constexpr bool valid = true;
+        static constexpr InArgTypeId in_id = InArgTypeId::INT_ARRAY_REF;
+        static constexpr OutArgTypeId out_id = OutArgTypeId::INT_ARRAY_REF;
+        static constexpr RArgTypeId r_id = RArgTypeId::WRONG;
+    };
+
+    template<>
+    struct ParamType<const std::vector<int> &> {
+        static constexpr const char *name = "constvector<int>&";
+        static constexpr bool valid = true;
+        static constexpr InArgTypeId in_id = InArgTypeId::CONST_INT_ARRAY_REF;
+        static constexpr OutArgTypeId out_id = OutArgTypeId::WRONG;
+        static constexpr RArgTypeId r_id = RArgTypeId::WRONG;
+    };
+
+    template<>
+    struct ParamType<std::vector<float> &> {
+        static constexpr const char *name = "vector<float>&";
+        static constexpr bool valid = true;
+        static constexpr InArgTypeId in_id = InArgTypeId::FLOAT_ARRAY_REF;
+        static constexpr OutArgTypeId out_id = OutArgTypeId::FLOAT_ARRAY_REF;
+        static constexpr RArgTypeId r_id = RArgTypeId::WRONG;
+    };
+
+    template<>
+    struct ParamType<const std::vector<float> &> {
+        static constexpr const char *name = "constvector<float>&";
+        static constexpr bool valid = true;
+        static constexpr InArgTypeId in_id = InArgTypeId::CONST_FLOAT_ARRAY_REF;
+        static constexpr OutArgTypeId out_id = OutArgTypeId::WRONG;
+        static constexpr RArgTypeId r_id = RArgTypeId::WRONG;
+    };
+#if P64
+    template<>
+    struct ParamType<std::vector<double> &> {
+        static constexpr const char *name = "vector<double>&";
+        static constexpr bool valid = true;
+        static constexpr InArgTypeId in_id = InArgTypeId::DOUBLE_ARRAY_REF;
+        static constexpr OutArgTypeId out_id = OutArgTypeId::DOUBLE_ARRAY_REF;
+        static constexpr RArgTypeId r_id = RArgTypeId::WRONG;
+    };
+
+    template<>
+    struct ParamType<const std::vector<double> &> {
+        static constexpr const char *name = "constvector<double>&";
+        static constexpr bool valid = true;
+        static constexpr InArgTypeId in_id = InArgTypeId::CONST_DOUBLE_ARRAY_REF;
+        static constexpr OutArgTypeId out_id = OutArgTypeId::WRONG;
+        static constexpr RArgTypeId r_id = RArgTypeId::WRONG;
+    };
+#endif
+
+    template<>
+    struct ParamType<array_view<short>> {
+        static constexpr const char *name = "array_view<short>";
+        static constexpr bool valid = true;
+        static constexpr InArgTypeId in_id = InArgTypeId::SHORT_VIEW;
+        static constexpr OutArgTypeId out_id = OutArgTypeId::WRONG;
+        static constexpr RArgTypeId r_id = RArgTypeId::WRONG;
+    };
+
+    template<>
+    struct ParamType<array_view<int>> {
+        static constexpr const char *name = "array_view<int>";
+        static constexpr bool valid = true;
+        static constexpr InArgTypeId in_id = InArgTypeId::INT_VIEW;
+        static constexpr OutArgTypeId out_id = OutArgTypeId::WRONG;
+        static constexpr RArgTypeId r_id = RArgTypeId::WRONG;
+    };
+
+    template<>
+    struct ParamType<array_view<float>> {
+        static constexpr const char *name = "array_view<float>";
+        static constexpr bool valid = true;
+        static constexpr InArgTypeId in_id = InArgTypeId::FLOAT_VIEW;
+        static constexpr OutArgTypeId out_id = OutArgTypeId::WRONG;
+        static constexpr RArgTypeId r_id = RArgTypeId::WRONG;
+    };
+#if P64
+    template<>
+    struct ParamType<array_view<double>> {
+        static constexpr const char *name = "array_view<double>";
+        static constexpr bool valid = true;
+        static constexpr InArgTypeId in_id = InArgTypeId::DOUBLE_VIEW;
+        static constexpr OutArgTypeId out_id = OutArgTypeId::WRONG;
+        static constexpr RArgTypeId r_id = RArgTypeId::WRONG;
+    };
+#endif
 #endif
 
     template<>
@@ -47,20 +47,27 @@ namespace rpc
             static_assert(Traits::arity == nargs, "Wrong parameters number!");
             static_assert(Traits::valid, "Not supported function signature!");
 
+            using Sig = Signature<R, Args...>;
+            Stub<D> rpc;
+            rpc.r_format = ParamType<R>::r_id;
+            rpc.in_args_format = Sig::in_format;
+            rpc.out_args_format = Sig::out_format;
+            rpc.id = Sig::id(name);
+            rpc.check = Sig::check(name);
             Stub<D>* p_rpc;
-            if((p_rpc = registry.find(name)) == nullptr){
+            if((p_rpc = registry.find(rpc.id)) == nullptr){
                 //new rpc
-                Stub<D> rpc;
-                rpc.r_format = ParamType<R>::r_id;
-                rpc.in_args_format = codify_in_args<Args...>();
-                rpc.out_args_format = codify_out_args<Args...>();
-                std::string sargs = stringify<Args...>();
-                rpc.id = std::string(ParamType<R>::name) + " " + name + " " + sargs;
                 rpc.n_handles = 1;
-                p_rpc = registry.insert(rpc);//insert rpc or get its pointer if already present
+                p_rpc = registry.insert(rpc);
+                if(p_rpc != nullptr && !bind(p_rpc)){//nullptr when the registry is full, unbindable index
+                    registry.remove(p_rpc);
+                    p_rpc = nullptr;
+                }
             }
-            else
+            else if(p_rpc->isSamePrototype(rpc))
                 p_rpc->n_handles++;
+            else
+                p_rpc = nullptr;//prototype id collision
 
             auto handle = RpcHandle<Stub<D>>(p_rpc);
             return handle;
@@ -71,14 +78,24 @@ namespace rpc
             if(p != nullptr){
                 p->n_handles--;
                 if(p->n_handles <= 0){
+                    m_invokations.release_all(p);
                     registry.remove(p);
                 }
                 handle.setStub(nullptr);
             }
         }
 
-        template <typename F, typename...Args>
-        bool asyncRPC(RpcHandle<Stub<D>>& handle, std::function<void(ReturnValue)>&& callback, Args&&... args){
+        //The callback receives a Result<R>, R being the return type of F, or the type-erased ReturnValue.
+        template <typename F, typename Cb, typename...Args>
+        auto asyncRPC(RpcHandle<Stub<D>>& handle, Cb&& callback, Args&&... args)
+                -> std::enable_if_t<!std::is_integral_v<typename remove_cvref<Cb>::type>, bool>{
+            return asyncRPC<F>(handle, (uint32_t)CALL_TIMEOUT_MS, std::forward<Cb>(callback), std::forward<Args>(args)...);
+        }
+
+        //The callback is invoked with a TIMEOUT status when the reply is not received within timeout_ms
+        //(0: no deadline).
+        template <typename F, typename Cb, typename...Args>
+        bool asyncRPC(RpcHandle<Stub<D>>& handle, uint32_t timeout_ms, Cb&& callback, Args&&... args){
             const size_t nargs = sizeof...(Args);
             using Traits = ParamTraits<F>;
 
@@ -91,101 +108,323 @@ namespace rpc
             static_assert(is_supported, "Wrong arguments types!");
 
             Stub<D>* rpc = handle.getStub();
-            if(rpc != nullptr && !tx_msg_full()){
-                rpc->invokations++;
-                rpc->invokation_id = rpc->invokations;
-                invokation_data data;
-                data.id = rpc->invokation_id;
+            if(rpc == nullptr || tx_msg_full() || window_full())
+                return false;
+            MsgHandle msg_handle = m_pool.acquire();
+            if(msg_handle == NO_MSG)
+                return false;
+            PoolHandle inv_handle = m_invokations.acquire(rpc);
+            if(inv_handle == NO_HANDLE){
+                m_pool.release(msg_handle);
+                return false;
+            }
 
-                if constexpr(std::is_same_v<D,std::string>)
-                {
-                    std::ostringstream ss;
-                    serialize_args<F>(data.out_args_addresses,ss,std::forward<Args>(args)...);
-                    rpc->in_args = ltrim(ss.str());
-                }
-                else//std::vector<unsigned char>
-                {
-                    rpc->in_args.clear();
-                    serialize_args<F>(data.out_args_addresses,rpc->in_args,std::forward<Args>(args)...);
-                }
+            invokation_data& data = m_invokations[inv_handle];
+            rpc->invokation_id = data.id;
 
-                data.callback = move(callback);
-                auto before_end = rpc->invokation_list.before_begin();
-                for (auto& _ : rpc->invokation_list)
-                    ++before_end;
-                rpc->invokation_list.insert_after(before_end, data);
+            //the arguments are encoded in place into the pooled message (std::string or Payload)
+            Message<D>& msg = m_pool[msg_handle];
+            auto& in_args = msg.getValue();
+            in_args.clear();
+            serialize_args<F>(data.out_args_addresses,in_args,std::forward<Args>(args)...);
 
-                Message<D> msg = rpc->marshall();
-                tx_msg_buffer.push(msg);
-                return true;
+            //heap-less capacity exceeded: the call fails
+            bool overflow = msg.overflow();
+#if HEAP_LESS
+            overflow = overflow || data.out_args_addresses.overflow();
+#endif
+            if(overflow){
+                m_invokations.release(inv_handle);
+                m_pool.release(msg_handle);
+                return false;
+            }
+
+            using R = typename Traits::return_type;
+            using Callback = std::decay_t<Cb>;
+            static_assert(std::is_invocable_v<Callback&, Result<R>> || std::is_invocable_v<Callback&, ReturnValue>,
+                          "The callback takes a Result<R> or a ReturnValue");
+            if(has_callback(callback)){
+                data.callback.emplace(std::forward<Cb>(callback));
+                data.complete = &complete<R, Callback>;
             }
-            return false;
+            else
+                data.complete = &complete<R, NoCallback>;//the output arguments are written all the same
+            if(timeout_ms > 0)
+                m_invokations.set_deadline(inv_handle, TimeOut_t::now() + timeout_ms);
+            rpc->marshall(msg);
+            tx_msg_buffer.push(msg_handle);
+            return true;
+        }
+
+        //Replies received after the deadline of their call, or for an older generation of its slot.
+        [[maybe_unused]] [[nodiscard]] size_t late_replies() const {
+            return m_invokations.late_replies();
         }
 
+        //Replies received again for an already completed call.
+        [[maybe_unused]] [[nodiscard]] size_t duplicate_replies() const {
+            return m_invokations.duplicate_replies();
+        }
+
+        //Flow control window: the calls that can wait for the reply at the same time.
+        [[maybe_unused]] [[nodiscard]] uint32_t window() const {
+            return m_window;
+        }
+
+        //Invokations waiting for their reply
+        [[maybe_unused]] [[nodiscard]] size_t in_flight() const {
+            return m_invokations.size();
+        }
+
+        [[maybe_unused]] bool isBound(RpcHandle<Stub<D>>& handle){
+            auto p = handle.getStub();
+            return p != nullptr && p->isBound();
+        }
+
+#if BMRPC_COROUTINES
+        //Awaitable call of the function type F: co_await yields a Result<R>.
+        template <typename F, typename...Args>
+        auto call(RpcHandle<Stub<D>>& handle, Args&&... args){
+            return Call<RpcClient, RpcHandle<Stub<D>>, F, Args...>(*this, handle, std::forward<Args>(args)...);
+        }
+
+        #define CALL_RPC(f, handle,args...) template call<decltype(f)>(handle, args)
+#endif
+
         #define EMPTY_CB std::function<void(ReturnValue)>()
         #define ASYNC_RPC_WITH_CB(f, handle,callback,args...) asyncRPC<decltype(f)>(handle, callback, args)
         #define ASYNC_RPC(f, handle,args...) asyncRPC<decltype(f)>(handle, EMPTY_CB, args)
+        #define ASYNC_RPC_WITH_TIMEOUT(f, handle,timeout_ms,callback,args...) asyncRPC<decltype(f)>(handle, (uint32_t)(timeout_ms), callback, args)
 
         void initLoop(){
             m_init_serializer = true;
             m_init_deserializer = true;
         }
 
+        //Readiness-driven loop: waits until the link has data to read or timeout_ms expires.
+        //Returns true when doLoop has work to do.
+        [[maybe_unused]] bool wait(uint32_t timeout_ms){
+            if(!tx_msg_buffer.empty() || !m_streamer.tx_empty())
+                return true;
+            return m_com->wait(timeout_ms);
+        }
+
         void doLoop(){
+#if BATCHING
+            if(m_init_serializer)//the calls queued since the last loop are sent as one frame
+                coalesce(m_pool, tx_msg_buffer);
+#endif
+
+            m_streamer.cork();//the driver is written when the buffer is full or at the end of the loop
+#if EVENT_DRIVEN_LOOP
+            while(!tx_msg_buffer.empty()){
+#else
             TimeOut_t tx_msg_tout;
-            static Message<D> tx_msg;
-            static Message<D> rx_msg;
 
             tx_msg_tout.preset(CLIENT_LOOP_TOUT_MS);
             tx_msg_tout.start();
             while(!tx_msg_buffer.empty() && !tx_msg_tout.expired()){
+#endif
                 if(m_init_serializer){
-                    tx_msg = tx_msg_buffer.front();
-                    m_serializer.init(&tx_msg);
+                    m_serializer.init(&m_pool[tx_msg_buffer.front()]);
                     m_init_serializer = false;
                 }
                 if(m_serializer.send()){
+                    m_pool.release(tx_msg_buffer.front());
                     tx_msg_buffer.pop();
                     m_init_serializer = true;
                 }
+#if EVENT_DRIVEN_LOOP
+                else if(m_streamer.tx_full())
+                    break;//link busy: the message is completed by the next loops
+#endif
             }
-            m_streamer.flush();
+            m_streamer.uncork();
 
+#if EVENT_DRIVEN_LOOP
+            //receives the messages ready on the link
+            while(true){
+#else
             TimeOut_t rx_msg_tout;
             rx_msg_tout.preset(CLIENT_LOOP_TOUT_MS);
             rx_msg_tout.start();
             while(!rx_msg_tout.expired()){
+#endif
                 if(m_init_deserializer) {
-                    m_deserializer.init(&rx_msg);
+                    if((m_rx_handle = m_pool.acquire()) == NO_MSG)
+                        break;//pool exhausted: receive when the pending messages have been dispatched
+                    m_deserializer.init(&m_pool[m_rx_handle]);
                     m_init_deserializer = false;
                 }
                 if(m_deserializer.receive()) {
-                    rx_msg_buffer.push(rx_msg);
+                    rx_msg_buffer.push(m_rx_handle);
                     m_init_deserializer = true;
                 }
+#if EVENT_DRIVEN_LOOP
+                else if(m_streamer.rx_size() == 0)
+                    break;//nothing more ready: a partial message is completed by the next loops
+#endif
             }
 
             while(!rx_msg_buffer.empty()){
-                Message<D> msg = rx_msg_buffer.front();
-                Stub<D>* rpc = registry.get(msg.getName());
-                rpc->unmarshall_and_dispatch(msg);
+                MsgHandle handle = rx_msg_buffer.front();
                 rx_msg_buffer.pop();
+                dispatch(handle);
             }
+
+            expire();
         }
 
     private:
-        FunctionsRegistry<Stub<D>> registry;
-        std::queue<Message<D>> tx_msg_buffer;
-        std::queue<Message<D>> rx_msg_buffer;
+
+        struct NoCallback{};
+
+        template <typename Cb>
+        static bool has_callback(const Cb& callback){
+            if constexpr(std::is_constructible_v<bool, const Cb&>)
+                return static_cast<bool>(callback);//std::function or function pointer
+            else
+                return true;
+        }
+
+        //Invokation completion thunk: the return value is decoded by its static type R and handed to the user
+        //callback as a Result<R>, or converted to a ReturnValue for the type-erased callbacks.
+        //The user callback is stored as it is in the invokation slot: a std::function or a small lambda is not allocated.
+        //The slot is released before the callback, which can issue a new call from it.
+        template <typename R, typename Callback>
+        static void complete(InvokationTable& table, PoolHandle handle, CallStatus status, void* reply){
+            Result<R> r(status);
+            if(reply != nullptr){
+                auto& rp = *static_cast<typename Stub<D>::Reply*>(reply);
+                r = rp.stub->template unmarshall_result<R>(*rp.msg, *rp.out_args_addresses);
+            }
+            if constexpr(std::is_same_v<Callback, NoCallback>){
+                release(table, handle, status);
+            }
+            else{
+                Callback callback = std::move(table[handle].callback.template get<Callback>());
+                release(table, handle, status);
+                if constexpr(std::is_invocable_v<Callback&, Result<R>>)
+                    callback(r);
+                else
+                    callback(to_return_value(r));
+            }
+        }
+
+        //An expired invokation is abandoned: its late reply is told apart from a duplicate one.
+        static void release(InvokationTable& table, PoolHandle handle, CallStatus status){
+            if(status == CallStatus::TIMEOUT)
+                table.abandon(handle);
+            else
+                table.release(handle);
+        }
+
+        //Completes with a REJECTED status the invokation refused by the server:
+        //window overflow, unknown method or truncated request.
+        void reject(Message<D>& msg){
+            InvokationId id;
+            if constexpr(std::is_same_v<D,std::string>)
+                msg.getId(id);
+            else
+                id = msg.getId();
+            PoolHandle handle = m_invokations.find(id);
+            if(handle == NO_HANDLE){
+                m_invokations.reject(id);
+                return;
+            }
+            m_invokations[handle].complete(m_invokations, handle, CallStatus::REJECTED, nullptr);
+        }
+
+        //Completes with a TIMEOUT status the invokations whose deadline has been reached.
+        //The slot is released before the callback: a late reply is dropped and the call can be retried from it.
+        void expire(){
+            if(!m_invokations.has_deadlines())
+                return;
+            uint32_t tick = TimeOut_t::now();
+            PoolHandle handle;
+            while((handle = m_invokations.expired(tick)) != NO_HANDLE)
+                m_invokations[handle].complete(m_invokations, handle, CallStatus::TIMEOUT, nullptr);
+        }
+
+        void dispatch(MsgHandle handle){
+            Message<D>& msg = m_pool[handle];
+            METHOD_ID_T method;
+            if constexpr(std::is_same_v<D,std::string>)
+                msg.getMethod(method);
+            else
+                method = msg.getMethod();
+            if(method == METHOD_ID_BIND) {
+                METHOD_ID_T bind_id;
+                if constexpr(std::is_same_v<D,std::string>)
+                    msg.getId(bind_id);
+                else
+                    bind_id = static_cast<METHOD_ID_T>(msg.getId());
+                Stub<D>* rpc = registry.at(bind_id);
+                uint32_t window;
+                if(rpc != nullptr && rpc->unmarshall_bind(msg, window))
+                    m_window = window;
+            }
+            else if(method == METHOD_ID_BUSY)
+                reject(msg);
+#if BATCHING
+            else if(method == METHOD_ID_BATCH) {
+                const Payload& batch = msg.getValue();
+                size_t ix = 0;
+                while(ix < batch.size()){
+                    MsgHandle sub = m_pool.acquire();
+                    if(sub == NO_MSG)
+                        break;//pool exhausted: the rest of the batch is dropped
+                    if((ix = batch_extract(batch, ix, m_pool[sub])) == 0){
+                        m_pool.release(sub);
+                        break;//truncated batch
+                    }
+                    dispatch(sub);
+                }
+            }
+#endif
+            else {
+                Stub<D>* rpc = registry.at(method);
+                if(rpc != nullptr && !msg.overflow())//a truncated reply is dropped
+                    rpc->unmarshall_and_dispatch(msg, m_invokations);
+            }
+            m_pool.release(handle);
+        }
+
+        //The method id of the stub is its registry index. Queues the binding request.
+        //Returns false when the index is beyond the ids the server can bind or the message pool is exhausted.
+        bool bind(Stub<D>* rpc){
+            size_t index = registry.index(rpc);
+            if(index >= MAX_REGISTRY_SIZE)
+                return false;//the id would be refused by the server, or would wrap into the reserved ids
+            MsgHandle handle = m_pool.acquire();
+            if(handle == NO_MSG)
+                return false;
+            rpc->method_id = static_cast<METHOD_ID_T>(index);
+            rpc->bound = false;
+            rpc->marshall_bind(m_pool[handle]);
+            tx_msg_buffer.push(handle);
+            return true;
+        }
+
+        Registry<Stub<D>> registry;
+        InvokationTable m_invokations;
+        MsgPool<D> m_pool;
+        MsgHandle m_rx_handle = NO_MSG;
+        MsgQueue tx_msg_buffer;
+        MsgQueue rx_msg_buffer;
         bool m_init_deserializer;
         bool m_init_serializer;
         Comm<T,C>* m_com;
         Streamer<T, C> m_streamer;
         DataDeserializer<C> m_deserializer;
         DataSerializer<C> m_serializer;
+        uint32_t m_window = FLOW_CONTROL_WINDOW;//updated by the window advertised by the server
         bool tx_msg_full(){
             return tx_msg_buffer.size() > MAX_CLIENT_MSG_BUFFER_SIZE;
         }
+        bool window_full(){
+            return FLOW_CONTROL_WINDOW > 0 && m_window > 0 && m_invokations.size() >= m_window;
+        }
     };
 
 }//namespace rpc
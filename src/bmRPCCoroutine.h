@@ -0,0 +1,153 @@
+/*
+ *
+ * Copyright 2022 Claudio Lanfranchi.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef BMRPCCOROUTINE_H
+#define BMRPCCOROUTINE_H
+
+#if BMRPC_COROUTINES
+
+namespace bm
+{
+namespace rpc
+{
+    /**
+     * Coroutine client API (C++20)
+     * co_await client.CALL_RPC(f, handle, args...) suspends the coroutine until the reply, the deadline
+     * or the rejection of the call and yields a Result<R>. The coroutine is resumed by RpcClient::doLoop().
+     * It coexists with the callback API: the call is an asyncRPC whose typed callback resumes the coroutine.
+     */
+
+    //Statically allocated coroutine frames: MAX_COROUTINES blocks of COROUTINE_FRAME_SIZE bytes.
+    class FramePool{
+    public:
+
+        static void* allocate(size_t size) noexcept {
+            if(size > COROUTINE_FRAME_SIZE)
+                return nullptr;
+            PoolHandle handle = pool().acquire();
+            return handle == NO_HANDLE ? nullptr : pool()[handle].bytes;
+        }
+
+        static void release(void* p) noexcept {
+            pool().release((PoolHandle)(static_cast<Block*>(p) - &pool()[0]));
+        }
+
+    private:
+        struct Block{
+            alignas(std::max_align_t) unsigned char bytes[COROUTINE_FRAME_SIZE];
+        };
+
+        static StaticPool<Block, MAX_COROUTINES>& pool(){
+            static StaticPool<Block, MAX_COROUTINES> blocks;
+            return blocks;
+        }
+    };
+
+    /**
+     * Task
+     * Fire-and-forget coroutine run eagerly until its first co_await: the frame is released at its end.
+     * started() is false when no frame was available (the coroutine has not run).
+     */
+    class Task{
+    public:
+        struct promise_type{
+            static void* operator new(size_t size) noexcept {
+                return FramePool::allocate(size);
+            }
+
+            static void operator delete(void* p) noexcept {
+                FramePool::release(p);
+            }
+
+            static Task get_return_object_on_allocation_failure() noexcept {
+                return Task(false);
+            }
+
+            Task get_return_object() noexcept {
+                return Task(true);
+            }
+
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+
+        [[nodiscard]] bool started() const {
+            return m_started;
+        }
+
+    private:
+        explicit Task(bool started):m_started(started){};
+        bool m_started;
+    };
+
+    /**
+     * Call
+     * Awaitable call of the function type F. The arguments are referenced, not copied: the call is
+     * co_awaited in the expression that creates it.
+     */
+    template <typename C, typename H, typename F, typename... Args>
+    class Call{
+    public:
+        using R = typename ParamTraits<F>::return_type;
+
+        Call(C& client, H& handle, Args&&... args):
+                m_client(client),
+                m_handle(handle),
+                m_args(std::forward<Args>(args)...)
+        {};
+
+        [[nodiscard]] bool await_ready() const noexcept {
+            return false;
+        }
+
+        //The callback captures only this: it is stored in place in the invokation slot, no allocation.
+        //The coroutine is not suspended when the call cannot be sent.
+        bool await_suspend(std::coroutine_handle<> coroutine){
+            m_coroutine = coroutine;
+            bool sent = std::apply([this](auto&... args){
+                return m_client.template asyncRPC<F>(m_handle, [this](Result<R> r){
+                    m_result = r;
+                    m_coroutine.resume();
+                }, args...);
+            }, m_args);
+            if(!sent)
+                m_result = Result<R>(CallStatus::REJECTED);
+            return sent;
+        }
+
+        Result<R> await_resume(){
+            return m_result;
+        }
+
+    private:
+        C& m_client;
+        H& m_handle;
+        std::tuple<Args&&...> m_args;
+        Result<R> m_result;
+        std::coroutine_handle<> m_coroutine;
+    };
+
+}//namespace rpc
+}//namespace bm
+
+#endif // BMRPC_COROUTINES
+
+#endif // BMRPCCOROUTINE_H
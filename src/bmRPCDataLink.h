@@ -26,6 +26,36 @@ namespace bm
 namespace rpc
 {
 
+    /**
+    *  Optional Comm hooks detection
+    */
+
+    template <typename C, typename = void>
+    struct has_available_impl: std::false_type{};
+
+    template <typename C>
+    struct has_available_impl<C, std::void_t<decltype(std::declval<C&>().available_impl())>>: std::true_type{};
+
+    template <typename C, typename = void>
+    struct has_writev_impl: std::false_type{};
+
+    template <typename C>
+    struct has_writev_impl<C, std::void_t<decltype(std::declval<C&>().writev_impl(
+            nullptr, size_t{}, nullptr, size_t{}))>>: std::true_type{};
+
+    template <typename C, typename = void>
+    struct has_wait_impl: std::false_type{};
+
+    template <typename C>
+    struct has_wait_impl<C, std::void_t<decltype(std::declval<C&>().wait_impl(uint32_t{}))>>: std::true_type{};
+
+    template <typename C, typename = void>
+    struct has_wake_impl: std::false_type{};
+
+    template <typename C>
+    struct has_wake_impl<C, std::void_t<decltype(std::declval<C&>().wake_impl())>>: std::true_type{};
+
+
     /**
     *  Com Interface
     */
@@ -59,6 +89,48 @@ namespace rpc
         INLINE size_t read(T buf[], size_t len) {
             return static_cast<C*>(this)->read_impl(buf,len);
         }
+
+        //Optional scatter-gather write of two buffers in one transfer (e.g. the two segments of a ring).
+        //Without it the buffers are written one after the other.
+        INLINE size_t writev(const T buf1[], size_t len1, const T buf2[], size_t len2) {
+            if constexpr(has_writev_impl<C>::value)
+                return static_cast<C*>(this)->writev_impl(buf1,len1,buf2,len2);
+            else{
+                size_t n = write(buf1, len1);
+                if(n == len1 && len2 > 0)
+                    n += write(buf2, len2);
+                return n;
+            }
+        }
+
+        //Optional readiness hooks.
+        //available_impl(): number of items ready to be read. Without it the link is always read.
+        //wait_impl(timeout_ms): blocks until items are ready or the timeout expires.
+        //Without it wait() does not block and reports the available items.
+        //wake_impl(): called from any thread, makes the pending or the next wait() return true.
+        //Without it the work posted by other threads is noticed when wait() returns.
+        INLINE size_t available(){
+            if constexpr(has_available_impl<C>::value)
+                return static_cast<C*>(this)->available_impl();
+            else
+                return std::numeric_limits<size_t>::max();
+        }
+
+        INLINE bool wait(uint32_t timeout_ms){
+            if constexpr(has_wait_impl<C>::value)
+                return static_cast<C*>(this)->wait_impl(timeout_ms);
+            else
+                return available() > 0;
+        }
+
+        static constexpr bool wakeable(){
+            return has_wake_impl<C>::value;
+        }
+
+        INLINE void wake(){
+            if constexpr(has_wake_impl<C>::value)
+                static_cast<C*>(this)->wake_impl();
+        }
     };
 
     /**
@@ -70,18 +142,10 @@ namespace rpc
     public:
 
         #define MAX_BUFFER_SIZE 256
-        SharedBuffer() {
-            in_queue = new std::array<T,MAX_BUFFER_SIZE>();
-            out_queue = new std::array<T,MAX_BUFFER_SIZE>();
-        }
-
-        ~SharedBuffer() {
-            delete in_queue;
-            delete out_queue;
-        }
+        SharedBuffer():in_queue(),out_queue(){}
 
         [[maybe_unused]] bool srv_can_read(){
-            return (in_queue->empty() == false);
+            return (in_queue.empty() == false);
         }
 
         size_t srv_read(T b[], size_t len){
@@ -90,9 +154,9 @@ namespace rpc
             }
             if(len > in_len) len = in_len;
             in_lock = true;
-            std::copy(in_queue->begin(), in_queue->begin() + len, b);
+            std::copy(in_queue.begin(), in_queue.begin() + len, b);
             if(len != in_len)//move remaining elements at the beginning of the array
-                std::move(in_queue->begin() + len,in_queue->begin() + in_len, in_queue->begin());
+                std::move(in_queue.begin() + len,in_queue.begin() + in_len, in_queue.begin());
             in_len -= len;
             in_lock = false;
             return len;
@@ -100,12 +164,12 @@ namespace rpc
 
         size_t srv_write(const T b[], size_t len){
             if(!out_lock && len > 0){
-                size_t capacity = out_queue->size() - out_len;
+                size_t capacity = out_queue.size() - out_len;
                 if(len > capacity){
                     len = capacity;
                 }
                 out_lock = true;
-                std::copy(b, b + len, out_queue->begin()+out_len);
+                std::copy(b, b + len, out_queue.begin()+out_len);
                 out_len += len;
                 out_lock = false;
                 return len;
@@ -113,8 +177,16 @@ namespace rpc
             return 0;
         }
 
+        [[nodiscard]] size_t srv_available() const {
+            return in_len;
+        }
+
+        [[nodiscard]] size_t cln_available() const {
+            return out_len;
+        }
+
         [[maybe_unused]] bool cln_can_read(){
-            return (out_queue->empty() == false);
+            return (out_queue.empty() == false);
         }
 
         size_t cln_read(T b[], size_t len){
@@ -123,9 +195,9 @@ namespace rpc
             }
             if(len > out_len) len = out_len;
             out_lock = true;
-            std::copy(out_queue->begin(), out_queue->begin() + len, b);
+            std::copy(out_queue.begin(), out_queue.begin() + len, b);
             if(len != out_len)//move remaining elements at the beginning of the array
-                std::move(out_queue->begin() + len,out_queue->begin() + out_len, out_queue->begin());
+                std::move(out_queue.begin() + len,out_queue.begin() + out_len, out_queue.begin());
             out_len -= len;
             out_lock = false;
             return len;
@@ -133,12 +205,12 @@ namespace rpc
 
         size_t cln_write(const T b[], size_t len){
             if(!in_lock && len > 0){
-                size_t capacity = in_queue->size() - in_len;
+                size_t capacity = in_queue.size() - in_len;
                 if(len > capacity){
                     len = capacity;
                 }
                 in_lock = true;
-                std::copy(b, b + len, in_queue->begin() + in_len);
+                std::copy(b, b + len, in_queue.begin() + in_len);
                 in_len += len;
                 in_lock = false;
                 return len;
@@ -148,10 +220,10 @@ namespace rpc
 
     private:
         //Queues directions are relative to the server side
-        std::array<T,MAX_BUFFER_SIZE>* in_queue;
+        std::array<T,MAX_BUFFER_SIZE> in_queue;
         size_t in_len = 0;
         bool in_lock = false;
-        std::array<T,MAX_BUFFER_SIZE>* out_queue;
+        std::array<T,MAX_BUFFER_SIZE> out_queue;
         size_t out_len = 0;
         bool out_lock = false;
     };
@@ -193,6 +265,10 @@ namespace rpc
             return sb.srv_read(buf, len);
         }
 
+        size_t available_impl() {
+            return sb.srv_available();
+        }
+
     private:
         SharedBuffer<T>& sb;
         const size_t m_max_packet_size = 8;
@@ -235,12 +311,258 @@ namespace rpc
             return sb.cln_read(buf, len);
         }
 
+        size_t available_impl() {
+            return sb.cln_available();
+        }
+
     private:
         SharedBuffer<T>& sb;
         const size_t m_max_packet_size = 8;
         bool m_open;
     };
 
+    /**
+    *  SpscRing
+    *  Lock-free single producer single consumer ring: one thread writes, one thread reads.
+    *  The indexes grow monotonically and live on separate cache lines with the cached copy of the
+    *  opposite index, so each side touches the shared line only when its cached view is exhausted.
+    *  The consumer may sleep in wait(): the producer takes the wait mutex only when the consumer is sleeping.
+    *  wake() ends the sleep from a third thread, without items.
+    */
+
+    constexpr size_t CACHE_LINE_SIZE = 64;
+
+    template <typename T, size_t N>
+    class SpscRing{
+    public:
+
+        //producer side
+        size_t write(const T b[], size_t len){
+            return writev(b, len, nullptr, 0);
+        }
+
+        //producer side: both buffers are published at once
+        size_t writev(const T b1[], size_t len1, const T b2[], size_t len2){
+            const size_t tail = m_tail.load(std::memory_order_relaxed);
+            size_t capacity = N - (tail - m_head_cache);
+            if(capacity < len1 + len2){
+                m_head_cache = m_head.load(std::memory_order_acquire);
+                capacity = N - (tail - m_head_cache);
+            }
+            if(len1 > capacity) len1 = capacity;
+            if(len2 > capacity - len1) len2 = capacity - len1;
+            if(len1 + len2 == 0) return 0;
+            copy_in(tail, b1, len1);
+            copy_in(tail + len1, b2, len2);
+            m_tail.store(tail + len1 + len2, std::memory_order_release);
+            //orders the tail store before the waiting load: either the consumer sees the items or it is woken up
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(m_waiting.load(std::memory_order_relaxed)){
+                std::lock_guard<std::mutex> lock(m_wait_mutex);
+                m_wait_cv.notify_one();
+            }
+            return len1 + len2;
+        }
+
+        //consumer side
+        size_t read(T b[], size_t len){
+            const size_t head = m_head.load(std::memory_order_relaxed);
+            size_t size = m_tail_cache - head;
+            if(size < len){
+                m_tail_cache = m_tail.load(std::memory_order_acquire);
+                size = m_tail_cache - head;
+            }
+            if(len > size) len = size;
+            if(len == 0) return 0;
+            const size_t ix = head & (N - 1);
+            const size_t n = std::min(len, N - ix);
+            std::copy(m_items.begin() + ix, m_items.begin() + ix + n, b);
+            std::copy(m_items.begin(), m_items.begin() + (len - n), b + n);
+            m_head.store(head + len, std::memory_order_release);
+            return len;
+        }
+
+        //consumer side
+        [[nodiscard]] size_t available(){
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            return m_tail_cache - m_head.load(std::memory_order_relaxed);
+        }
+
+        //consumer side: blocks until items are ready, wake() is called or timeout_ms expires.
+        //Returns true when items are ready or it has been woken.
+        bool wait(uint32_t timeout_ms){
+            if(available() > 0 || m_woken.exchange(false, std::memory_order_relaxed))
+                return true;
+            std::unique_lock<std::mutex> lock(m_wait_mutex);
+            m_waiting.store(true, std::memory_order_relaxed);
+            //orders the waiting store before the tail and woken loads of the predicate
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool ready = m_wait_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this]{
+                return available() > 0 || m_woken.exchange(false, std::memory_order_relaxed);
+            });
+            m_waiting.store(false, std::memory_order_relaxed);
+            return ready;
+        }
+
+        //any thread: the pending or the next wait() returns true
+        void wake(){
+            m_woken.store(true, std::memory_order_relaxed);
+            //orders the woken store before the waiting load, as writev does for the tail
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(m_waiting.load(std::memory_order_relaxed)){
+                std::lock_guard<std::mutex> lock(m_wait_mutex);
+                m_wait_cv.notify_one();
+            }
+        }
+
+    private:
+        void copy_in(size_t pos, const T b[], size_t len){
+            const size_t ix = pos & (N - 1);
+            const size_t n = std::min(len, N - ix);
+            std::copy(b, b + n, m_items.begin() + ix);
+            std::copy(b + n, b + len, m_items.begin());
+        }
+
+        //consumer line
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head{0};
+        size_t m_tail_cache = 0;
+        //producer line
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail{0};
+        size_t m_head_cache = 0;
+        //consumer sleeping in wait()
+        alignas(CACHE_LINE_SIZE) std::atomic<bool> m_waiting{false};
+        std::atomic<bool> m_woken{false};
+        std::mutex m_wait_mutex;
+        std::condition_variable m_wait_cv;
+        alignas(CACHE_LINE_SIZE) std::array<T, N> m_items{};
+    };
+
+    /**
+    *  SpscChannel
+    *  In-process link for a server and a client running on separate threads.
+    *  Directions are relative to the server side.
+    */
+
+    template <typename T>
+    struct SpscChannel{
+        SpscRing<T, SPSC_RING_SIZE> in_ring;
+        SpscRing<T, SPSC_RING_SIZE> out_ring;
+    };
+
+    /**
+    *  SpscServerCom
+    */
+
+    template <typename T>
+    class SpscServerCom: public Comm<T,SpscServerCom<T>> {
+    public:
+
+        explicit SpscServerCom(SpscChannel<T>& ch):ch(ch),m_open(false){};
+
+        int open_impl() {
+            if(m_open) return -1;
+            m_open = true;
+            return 0;
+        }
+
+        void close_impl() {
+            m_open = false;
+        }
+
+        bool is_open_impl() {
+            return m_open;
+        }
+
+        size_t get_packet_size_impl() {
+            return SPSC_RING_SIZE;
+        }
+
+        size_t write_impl(const T buf[], size_t len) {
+            return ch.out_ring.write(buf, len);
+        }
+
+        size_t writev_impl(const T buf1[], size_t len1, const T buf2[], size_t len2) {
+            return ch.out_ring.writev(buf1, len1, buf2, len2);
+        }
+
+        size_t read_impl(T buf[], size_t len) {
+            return ch.in_ring.read(buf, len);
+        }
+
+        size_t available_impl() {
+            return ch.in_ring.available();
+        }
+
+        bool wait_impl(uint32_t timeout_ms) {
+            return ch.in_ring.wait(timeout_ms);
+        }
+
+        void wake_impl() {
+            ch.in_ring.wake();
+        }
+
+    private:
+        SpscChannel<T>& ch;
+        bool m_open;
+    };
+
+    /**
+    *  SpscClientCom
+    */
+
+    template <typename T>
+    class SpscClientCom: public Comm<T,SpscClientCom<T>> {
+    public:
+
+        explicit SpscClientCom(SpscChannel<T>& ch):ch(ch),m_open(false){};
+
+        int open_impl() {
+            if(m_open) return -1;
+            m_open = true;
+            return 0;
+        }
+
+        void close_impl() {
+            m_open = false;
+        }
+
+        bool is_open_impl() {
+            return m_open;
+        }
+
+        size_t get_packet_size_impl() {
+            return SPSC_RING_SIZE;
+        }
+
+        size_t write_impl(const T buf[], size_t len) {
+            return ch.in_ring.write(buf, len);
+        }
+
+        size_t writev_impl(const T buf1[], size_t len1, const T buf2[], size_t len2) {
+            return ch.in_ring.writev(buf1, len1, buf2, len2);
+        }
+
+        size_t read_impl(T buf[], size_t len) {
+            return ch.out_ring.read(buf, len);
+        }
+
+        size_t available_impl() {
+            return ch.out_ring.available();
+        }
+
+        bool wait_impl(uint32_t timeout_ms) {
+            return ch.out_ring.wait(timeout_ms);
+        }
+
+        void wake_impl() {
+            ch.out_ring.wake();
+        }
+
+    private:
+        SpscChannel<T>& ch;
+        bool m_open;
+    };
+
     /**
     *  EmptyCom
     *  Empty com example to be filled with your implementation
@@ -275,6 +597,12 @@ namespace rpc
             return 0;
         }
 
+        //Optional scatter-gather and readiness hooks
+        //size_t writev_impl(const T buf1[], size_t len1, const T buf2[], size_t len2) { return 0; }
+        //size_t available_impl() { return 0; }
+        //bool wait_impl(uint32_t timeout_ms) { return false; }
+        //void wake_impl() {}
+
     private:
         const size_t m_max_packet_size = 8;
     };
@@ -25,55 +25,89 @@ namespace bm
 namespace rpc
 {
 
-    /**
-     * Server Marshaller
-     */
-    template <typename D, typename E>
-    inline void unmarshall_args_in(const D& data, E& in_args){
-        if constexpr(std::is_same_v<D, std::string>) {
-            in_args = split(data);
-        }
-        else {
-            in_args = data;
-        }
+    //Client side: addresses of the output arguments of a pending invokation (fixed capacity in heap-less mode)
+    using OutArgsAddresses = std::conditional_t<HEAP_LESS, StaticVector<void*, MAX_OUT_ARGS>, std::vector<void*>>;
+
+    //Argument formats of a connected function: views on its constexpr format tables
+    using InFormat = array_view<InArgTypeId>;
+    using OutFormat = array_view<OutArgTypeId>;
+
+    //Server side: scratch argument i of the call in progress, reused across the calls.
+    //In heap-less mode the scratch arguments are statically sized: the functions have at most MAX_ARGS arguments.
+    template<typename A>
+    A* scratch_arg(size_t i, size_t nargs){
+        SCRATCH_STORAGE std::conditional_t<HEAP_LESS, StaticVector<A, MAX_ARGS>, std::vector<A>> scratch;
+        if(scratch.size() < nargs) scratch.resize(nargs);
+        return &scratch[i];
     }
 
+    //Server side: a view argument and the copy it points to when the payload cannot be viewed in place
+    template<typename E>
+    struct ViewArg{
+        array_view<E> view;
+        std::vector<E> copy;
+    };
+
+#if BINARY_BASED_PROTOCOL
+    //Server side: decodes the numeric array at ix into the scratch argument i. Returns the decoded size, 0 when truncated.
+    template<typename E>
+    size_t decode_array_arg(Payload& data, std::ptrdiff_t ix, AnyArg& val, size_t i, size_t nargs){
+        std::vector<E>* const p = scratch_arg<std::vector<E>>(i, nargs);
+        p->clear();
+        val = AnyArg(p);
+        return stream::read(data.data()+ix, data.size()-ix, *p);
+    }
+
+    //Server side: decodes the array at ix as a view held by the scratch argument i. Returns the decoded size, 0 when truncated.
+    template<typename E>
+    size_t decode_view_arg(Payload& data, std::ptrdiff_t ix, AnyArg& val, size_t i, size_t nargs){
+        ViewArg<E>* const p = scratch_arg<ViewArg<E>>(i, nargs);
+        auto const pview = &p->view;
+        val = AnyArg(pview);
+        return stream::read(data.data()+ix, data.size()-ix, p->view, p->copy);
+    }
+
+    //Client side: decodes the numeric array at ix into the output argument. Returns the decoded size, 0 when truncated.
+    template<typename E>
+    size_t decode_array_out_arg(Payload& data, std::ptrdiff_t ix, void* address){
+        auto p = reinterpret_cast<std::vector<E>*>(address);
+        p->clear();
+        return stream::read(data.data()+ix, data.size()-ix, *p);
+    }
+#endif
 
     /**
      * Server side: from stream to args
+     * vec has room for format.size() arguments.
+     * Returns false when the arguments are truncated.
      */
     template <typename D>
-    [[maybe_unused]] static std::vector<AnyArg> deserialize_in_args(std::vector<InArgTypeId>& format, D& data){
-        std::vector<AnyArg> vec;
-        return vec;
-    }
+    [[maybe_unused]] static bool deserialize_in_args(InFormat format, D& data, AnyArg* vec){ return false; }
 
     template <>
-    [[maybe_unused]] std::vector<AnyArg> deserialize_in_args(std::vector<InArgTypeId>& format,std::vector<std::string>& data){
-        std::vector<AnyArg> vec;
-        vec.reserve(format.size());
-        for(int i = 0; i < format.size(); ++i){
+    [[maybe_unused]] bool deserialize_in_args(InFormat format,std::vector<std::string_view>& data, AnyArg* vec){
+        for(size_t i = 0; i < format.size(); ++i){
             AnyArg val;
             switch(format[i]){
                 case InArgTypeId::BOOL:
                 case InArgTypeId::UCHAR:
                 case InArgTypeId::CHAR:
                 {
-                    char cconv;
+                    char cconv{};
                     stream::read(data[i], cconv);
                     val = AnyArg(cconv);
                 }
                     break;
                 case InArgTypeId::SHORT:
                 {
-                    short sconv;
+                    short sconv{};
                     stream::read(data[i], sconv);
                     val = AnyArg(sconv);
                 }
                 break;
                 case InArgTypeId::USHORT:
                 {
-                    unsigned short usconv;
+                    unsigned short usconv{};
                     stream::read(data[i], usconv);
                     val = AnyArg(usconv);
                 }
@@ -81,14 +115,14 @@ namespace rpc
                 case InArgTypeId::INT:
                 case InArgTypeId::INT_REF:
                 {
-                    int iconv;
+                    int iconv{};
                     stream::read(data[i], iconv);
                     val = AnyArg(iconv);
                 }
                     break;
                 case InArgTypeId::UINT:
                 {
-                    unsigned int uiconv;
+                    unsigned int uiconv{};
                     stream::read(data[i], uiconv);
                     val = AnyArg(uiconv);
                 }
@@ -96,14 +130,14 @@ namespace rpc
                 case InArgTypeId::LONG:
                 case InArgTypeId::LONG_REF:
                 {
-                    long lconv;
+                    long lconv{};
                     stream::read(data[i], lconv);
                     val = AnyArg(lconv);
                 }
                     break;
                 case InArgTypeId::ULONG:
                 {
-                    unsigned long ulconv;
+                    unsigned long ulconv{};
                     stream::read(data[i], ulconv);
                     val = AnyArg(ulconv);
                 }
@@ -111,7 +145,7 @@ namespace rpc
                 case InArgTypeId::FLOAT:
                 case InArgTypeId::FLOAT_REF:
                 {
-                    float fconv;
+                    float fconv{};
                     stream::read(data[i], fconv);
                     val = AnyArg(fconv);
                 }
@@ -119,7 +153,8 @@ namespace rpc
                 case InArgTypeId::CONST_STRING_REF:
                 case InArgTypeId::STRING_REF:
                 {
-                    auto const s = new std::string(std::move(data[i]));//deleted in serialize_out_args
+                    auto const s = scratch_arg<std::string>(i, format.size());
+                    s->assign(data[i]);//keeps its capacity
                     val = AnyArg(s);
                 }
                     break;
@@ -127,14 +162,14 @@ namespace rpc
                 case InArgTypeId::LONGLONG:
                 case InArgTypeId::LONGLONG_REF:
                 {
-                    long long llconv;
+                    long long llconv{};
                     stream::read(data[i], llconv);
                     val = AnyArg(llconv);
                 }
                     break;
                 case InArgTypeId::ULONGLONG:
                 {
-                    unsigned long long ullconv;
+                    unsigned long long ullconv{};
                     stream::read(data[i], ullconv);
                     val = AnyArg(ullconv);
                 }
@@ -142,7 +177,7 @@ namespace rpc
                 case InArgTypeId::DOUBLE:
                 case InArgTypeId::DOUBLE_REF:
                 {
-                    double dconv;
+                    double dconv{};
                     stream::read(data[i], dconv);
                     val = AnyArg(dconv);
                 }
@@ -154,33 +189,31 @@ namespace rpc
                     AnyArg();
                     break;
             }
-            vec.push_back(val);
+            vec[i] = val;
         }
-        return vec;
+        return true;
     }
 
     template <>
-    [[maybe_unused]] std::vector<AnyArg> deserialize_in_args(std::vector<InArgTypeId>& format, std::vector<unsigned char>& data){
-        std::vector<AnyArg> vec;
-        std::vector<unsigned char>::difference_type ix = 0;
-        vec.reserve(format.size());
+    [[maybe_unused]] bool deserialize_in_args(InFormat format, Payload& data, AnyArg* vec){
+        std::ptrdiff_t ix = 0;
+        size_t i = 0;
         for(auto f: format){
             AnyArg val;
+            size_t n = 0;
             switch(f){
                 case InArgTypeId::BOOL:
                 case InArgTypeId::UCHAR:
                 case InArgTypeId::CHAR:
                 {   char cconv;
-                    stream::read(data.begin()+ix, cconv);
-                    ix += sizeof(char);
+                    n = stream::read(data.data()+ix, data.size()-ix, cconv);
                     val = AnyArg(cconv);
                 }
                     break;
                 case InArgTypeId::USHORT:
                 case InArgTypeId::SHORT:
                 {   short sconv;
-                    stream::read(data.begin()+ix, sconv);
-                    ix += sizeof(short);
+                    n = stream::read(data.data()+ix, data.size()-ix, sconv);
                     val = AnyArg(sconv);
                 }
                     break;
@@ -188,8 +221,7 @@ namespace rpc
                 case InArgTypeId::UINT:
                 case InArgTypeId::INT_REF:
                 {   int iconv;
-                    stream::read(data.begin()+ix, iconv);
-                    ix += sizeof(int);
+                    n = stream::read(data.data()+ix, data.size()-ix, iconv);
                     val = AnyArg(iconv);
                 }
                     break;
@@ -197,27 +229,29 @@ namespace rpc
                 case InArgTypeId::ULONG:
                 case InArgTypeId::LONG_REF:
                 {   long lconv;
-                    stream::read(data.begin()+ix, lconv);
-                    ix += sizeof(long);
+                    n = stream::read(data.data()+ix, data.size()-ix, lconv);
                     val = AnyArg(lconv);
                 }
                     break;
                 case InArgTypeId::FLOAT:
                 case InArgTypeId::FLOAT_REF:
                 {   float fconv;
-                    stream::read(data.begin()+ix, fconv);
-                    ix +=  sizeof(float);
+                    n = stream::read(data.data()+ix, data.size()-ix, fconv);
                     val = AnyArg(fconv);
                 }
                     break;
                 case InArgTypeId::CONST_STRING_REF:
                 case InArgTypeId::STRING_REF:
                 {
-                    SIZE_T length;
-                    stream::read(data.begin()+ix, length);
-                    ix += sizeof(SIZE_T);
-                    auto const s = new std::string(data.begin()+ix, data.begin()+ix+length);//deleted in serialize_out_args
-                    ix += length;
+                    SIZE_T length = 0;
+                    n = stream::read_length(data.data()+ix, data.size()-ix, length);
+                    if(n == 0 || data.size()-ix-n < length){
+                        n = 0;
+                        break;
+                    }
+                    auto const s = scratch_arg<std::string>(i, format.size());
+                    s->assign(data.begin()+ix+n, data.begin()+ix+n+length);//keeps its capacity
+                    n += length;
                     val = AnyArg(s);
                 }
                     break;
@@ -225,22 +259,55 @@ namespace rpc
                 case InArgTypeId::CONST_BLOB_REF:
                 case InArgTypeId::BLOB_REF:
                 {
-                    SIZE_T length;
-                    stream::read(data.begin()+ix, length);
-                    ix += sizeof(SIZE_T);
-                    blob* const s = new blob(data.begin()+ix, data.begin()+ix+length);//deleted in serialize_out_args
-                    ix += length;
+                    SIZE_T length = 0;
+                    n = stream::read_length(data.data()+ix, data.size()-ix, length);
+                    if(n == 0 || data.size()-ix-n < length){
+                        n = 0;
+                        break;
+                    }
+                    blob* const s = scratch_arg<blob>(i, format.size());
+                    s->assign(data.begin()+ix+n, data.begin()+ix+n+length);
+                    n += length;
                     val = AnyArg(s);
                 }
                     break;
+                case InArgTypeId::CONST_SHORT_ARRAY_REF:
+                case InArgTypeId::SHORT_ARRAY_REF:
+                    n = decode_array_arg<short>(data, ix, val, i, format.size());
+                    break;
+                case InArgTypeId::CONST_INT_ARRAY_REF:
+                case InArgTypeId::INT_ARRAY_REF:
+                    n = decode_array_arg<int>(data, ix, val, i, format.size());
+                    break;
+                case InArgTypeId::CONST_FLOAT_ARRAY_REF:
+                case InArgTypeId::FLOAT_ARRAY_REF:
+                    n = decode_array_arg<float>(data, ix, val, i, format.size());
+                    break;
+                case InArgTypeId::SHORT_VIEW:
+                    n = decode_view_arg<short>(data, ix, val, i, format.size());
+                    break;
+                case InArgTypeId::INT_VIEW:
+                    n = decode_view_arg<int>(data, ix, val, i, format.size());
+                    break;
+                case InArgTypeId::FLOAT_VIEW:
+                    n = decode_view_arg<float>(data, ix, val, i, format.size());
+                    break;
+#if P64
+                case InArgTypeId::CONST_DOUBLE_ARRAY_REF:
+                case InArgTypeId::DOUBLE_ARRAY_REF:
+                    n = decode_array_arg<double>(data, ix, val, i, format.size());
+                    break;
+                case InArgTypeId::DOUBLE_VIEW:
+                    n = decode_view_arg<double>(data, ix, val, i, format.size());
+                    break;
+#endif
 #endif
 #if P64
                 case InArgTypeId::LONGLONG:
                 case InArgTypeId::ULONGLONG:
                 case InArgTypeId::LONGLONG_REF:
                 {   long long llconv;
-                    stream::read(data.begin()+ix, llconv);
-                    ix += sizeof(long long);
+                    n = stream::read(data.data()+ix, data.size()-ix, llconv);
                     val = AnyArg(llconv);
                 }
                     break;
@@ -248,8 +315,7 @@ namespace rpc
                 case InArgTypeId::DOUBLE_REF:
                 {
                     double dconv;
-                    stream::read(data.begin()+ix, dconv);
-                    ix += sizeof(double);
+                    n = stream::read(data.data()+ix, data.size()-ix, dconv);
                     val = AnyArg(dconv);
                 }
                     break;
@@ -259,9 +325,12 @@ namespace rpc
                     AnyArg();
                     break;
             }
-            vec.push_back(val);
+            if(n == 0)
+                return false;//truncated
+            ix += n;
+            vec[i++] = val;
         }
-        return vec;
+        return true;
     }
 
     /**
@@ -296,7 +365,7 @@ namespace rpc
     }
 
     template <typename T>
-    void serialize_out_args(std::vector<InArgTypeId>& format, std::vector<AnyArg>& arr, T& buffer){
+    void serialize_out_args(InFormat format, AnyArg* arr, T& buffer){
         size_t i = 0;
         for(auto f: format){
             switch(f){
@@ -310,18 +379,22 @@ namespace rpc
                 case InArgTypeId::LONG:
                 case InArgTypeId::ULONG:
                 case InArgTypeId::FLOAT:
-                    ++i;
-                    break;
                 case InArgTypeId::CONST_STRING_REF:
-                    delete arr[i].getAs<const std::string*>();//allocated by deserialize_in_args
-                    ++i;
-                    break;
 #if BINARY_BASED_PROTOCOL
                 case InArgTypeId::CONST_BLOB_REF:
-                    delete arr[i].getAs<const blob*>();//allocated by deserialize_in_args
+                case InArgTypeId::CONST_SHORT_ARRAY_REF:
+                case InArgTypeId::CONST_INT_ARRAY_REF:
+                case InArgTypeId::CONST_FLOAT_ARRAY_REF:
+                case InArgTypeId::SHORT_VIEW:
+                case InArgTypeId::INT_VIEW:
+                case InArgTypeId::FLOAT_VIEW:
+#if P64
+                case InArgTypeId::CONST_DOUBLE_ARRAY_REF:
+                case InArgTypeId::DOUBLE_VIEW:
+#endif
+#endif
                     ++i;
                     break;
-#endif
                 case InArgTypeId::INT_REF:
                     arr[i++].write<int>(buffer);
                     break;
@@ -332,20 +405,26 @@ namespace rpc
                     arr[i++].write<float>(buffer);
                     break;
                 case InArgTypeId::STRING_REF:
-                {
-                    arr[i].write<std::string*>(buffer);
-                    delete arr[i].getAs<std::string*>();//allocated by deserialize_in_args
-                    ++i;
-                }
+                    arr[i++].write<std::string*>(buffer);
                     break;
 #if BINARY_BASED_PROTOCOL
                 case InArgTypeId::BLOB_REF:
-                {
-                    arr[i].write<blob*>(buffer);
-                    delete arr[i].getAs<blob*>();//allocated by deserialize_in_args
-                    ++i;
-                }
+                    arr[i++].write<blob*>(buffer);
+                    break;
+                case InArgTypeId::SHORT_ARRAY_REF:
+                    arr[i++].write<std::vector<short>*>(buffer);
+                    break;
+                case InArgTypeId::INT_ARRAY_REF:
+                    arr[i++].write<std::vector<int>*>(buffer);
+                    break;
+                case InArgTypeId::FLOAT_ARRAY_REF:
+                    arr[i++].write<std::vector<float>*>(buffer);
                     break;
+#if P64
+                case InArgTypeId::DOUBLE_ARRAY_REF:
+                    arr[i++].write<std::vector<double>*>(buffer);
+                    break;
+#endif
 #endif
 #if P64
                 case InArgTypeId::DOUBLE_REF:
@@ -368,126 +447,169 @@ namespace rpc
         }
     }
 
-    //Client side: first element is the return value when its format differs from void
-    template <typename D, typename E, typename F>
-    void unmarshall_out_args(const RArgTypeId format, const D& data, E& r_arg, F& out_args){
-        using TData = typename std::conditional<std::is_same_v<D,std::string>, std::vector<std::string>, std::vector<unsigned char>>::type;
-        TData sdata;
-        out_args.clear();
-        r_arg.clear();
-        if constexpr(std::is_same_v<D, std::string>)
-        {
-            sdata = split(data);
-            size_t ix = 0;
-            if(format != RArgTypeId::VOID) {
-                r_arg = sdata[0];
-                ix = 1;
-            }
-            size_t n = sdata.size();
-            out_args.reserve(n);
-            for (size_t i = ix; i < n; i++)
-                out_args.push_back(sdata[i]);
+    //Client side: type-erased return value of the callbacks taking a ReturnValue.
+    //An undecodable return value is reported invalid with the OK status, the other failures with their status.
+    template <typename R>
+    ReturnValue to_return_value(const Result<R>& r){
+        if constexpr(!std::is_void_v<R>){
+            if(r.ok())
+                return ReturnValue(true, ParamType<R>::r_id, AnyArg(r.value()));
         }
+        if(r.status() == CallStatus::OK || r.status() == CallStatus::INVALID)
+            return ReturnValue();
+        return ReturnValue(r.status());
+    }
+
+    template<typename R, typename... Args, std::size_t ... Is>
+    auto callFuncWithArgs(R (*function)(Args...), AnyArg* vArgs, std::index_sequence<Is...> const &) {
+        return function(vArgs[Is].getAs<Args>()...);
+    }
+
+    template<typename... Args, std::size_t ... Is>
+    void callProcWithArgs(void (*function)(Args...), AnyArg* vArgs, std::index_sequence<Is...> const &) {
+        function(vArgs[Is].getAs<Args>()...);
+    }
+
+    template<typename C, typename... Args, std::size_t ... Is>
+    void callAsyncWithArgs(void (*function)(C, Args...), C&& completion, AnyArg* vArgs, std::index_sequence<Is...> const &) {
+        function(std::move(completion), vArgs[Is].getAs<Args>()...);
+    }
+
+    /**
+    * Typed Marshaller
+    * Server side, binary protocol: the connected signature selects the codec of each argument at compile time.
+    */
+
+    //Output arguments are the non-const references and pointers
+    template<typename A>
+    constexpr bool is_out_arg_v = (std::is_lvalue_reference_v<A> && !std::is_const_v<std::remove_reference_t<A>>)
+                                  || (std::is_pointer_v<A> && !std::is_const_v<std::remove_pointer_t<A>>);
+
+    //The decoded value of an argument passed by value, reference or pointer
+    template<typename T>
+    struct arg_value{
+        using type = T;
+    };
+
+    template<typename E>
+    struct arg_value<array_view<E>>{
+        using type = ViewArg<E>;
+    };
+
+    template<typename A>
+    using arg_value_t = typename arg_value<typename remove_all<A>::type>::type;
+
+    template<typename T>
+    constexpr bool is_view_arg_v = false;
+
+    template<typename E>
+    constexpr bool is_view_arg_v<ViewArg<E>> = true;
+
+    //Binary encoded size of a length prefix
+    INLINE size_t encoded_length_size(size_t length){
+        if constexpr(COMPACT_ENCODING)
+            return varint_size(length);
         else
-        {
-            if (format == RArgTypeId::VOID)
-            {
-                out_args = data;
-            }
+            return sizeof(SIZE_T);
+    }
+
+    //Binary encoded size of an argument passed by value, reference or pointer
+    template<typename T>
+    INLINE size_t encoded_size(const T& arg){
+        using t = typename remove_all<T>::type;
+        if constexpr(std::is_same_v<t, std::string> || std::is_same_v<t, std::vector<unsigned char>>){
+            if constexpr(std::is_pointer_v<T>)
+                return encoded_length_size(arg->size()) + arg->size();
             else
-            {
-                size_t size;
-                switch (format) {
-                    case RArgTypeId::INT:
-                        size = sizeof(int);
-                        break;
-                    case RArgTypeId::LONG:
-                        size = sizeof(long);
-                        break;
-                    case RArgTypeId::FLOAT:
-                        size = sizeof(float);
-                        break;
-#if P64
-                    case RArgTypeId::LONGLONG:
-                        size = sizeof(long long);
-                        break;
-                    case RArgTypeId::DOUBLE:
-                        size = sizeof(double);
-                        break;
-#endif
-                    default:
-                        size = 0;
-                        break;
-                }
-                if(size > 0){
-                    std::copy(data.begin(), data.begin()+size, std::back_inserter(r_arg));
-                    std::copy(data.begin() + size, data.end(), std::back_inserter(out_args));
-                }
-            }
+                return encoded_length_size(arg.size()) + arg.size();
+        }
+        else if constexpr(is_array_arg_v<t> || is_array_view_v<t>){
+            if constexpr(std::is_pointer_v<T>)
+                return encoded_length_size(arg->size()) + arg->size() * sizeof(typename t::value_type);
+            else
+                return encoded_length_size(arg.size()) + arg.size() * sizeof(typename t::value_type);
         }
+        else if constexpr(stream::is_varint_v<t>){
+            if constexpr(std::is_pointer_v<T>)
+                return varint_size(zigzag(std::make_signed_t<t>(*arg)));
+            else
+                return varint_size(zigzag(std::make_signed_t<t>(arg)));
+        }
+        else
+            return sizeof(t);
     }
 
-    //Client side: from stream to return value
-    template <typename D>
-    ReturnValue deserialize_r(RArgTypeId format, D& data){
-        AnyArg val;
-        bool valid = true;
-        switch(format){
-            case RArgTypeId::INT:
-            {
-                int iconv;
-                stream::read(data, iconv);
-                val = AnyArg(iconv);
-            }
-                break;
-            case RArgTypeId::LONG:
-            {
-                long lconv;
-                stream::read(data, lconv);
-                val = AnyArg(lconv);
-            }
-                break;
-            case RArgTypeId::FLOAT:
-            {
-                float fconv;
-                stream::read(data, fconv);
-                val = AnyArg(fconv);
-            }
-                break;
-#if P64
-            case RArgTypeId::LONGLONG:
-            {
-                long long llconv;
-                stream::read(data, llconv);
-                val = AnyArg(llconv);
-            }
-                break;
-            case RArgTypeId::DOUBLE:
-            {
-                double dconv;
-                stream::read(data, dconv);
-                val = AnyArg(dconv);
-            }
-                break;
-#endif
-            default:
-            {
-                valid = false;
-                val = AnyArg();
-            }
-                break;
+    //Decodes the argument at p, before end. Returns false when truncated.
+    template<typename T>
+    INLINE bool decode_arg(const unsigned char*& p, const unsigned char* end, T& arg){
+        size_t n;
+        if constexpr(std::is_same_v<T, std::string> || std::is_same_v<T, std::vector<unsigned char>>){
+            SIZE_T length = 0;
+            n = stream::read_length(p, end - p, length);
+            if(n == 0 || size_t(end - p) - n < length)
+                return false;
+            arg.assign(p + n, p + n + length);//keeps its capacity
+            n += length;
+        }
+        else if constexpr(is_array_arg_v<T>){
+            arg.clear();
+            n = stream::read(p, end - p, arg);
         }
-        return ReturnValue(valid,format,val);
+        else if constexpr(is_view_arg_v<T>){
+            n = stream::read(p, end - p, arg.view, arg.copy);
+        }
+        else{
+            n = stream::read(p, end - p, arg);
+        }
+        p += n;
+        return n != 0;
     }
 
-    template<typename R, typename... Args, std::size_t ... Is>
-    auto callFuncWithArgs(R (*function)(Args...), std::vector<AnyArg> & vArgs, std::index_sequence<Is...> const &) {
-        return function(vArgs[Is].getAs<Args>()...);
+    template<typename A>
+    INLINE decltype(auto) pass_arg(arg_value_t<A>& arg){
+        if constexpr(std::is_pointer_v<A>)
+            return &arg;
+        else if constexpr(is_view_arg_v<arg_value_t<A>>)
+            return arg.view;
+        else
+            return (arg);
     }
 
-    template<typename... Args, std::size_t ... Is>
-    void callProcWithArgs(void (*function)(Args...), std::vector<AnyArg>& vArgs, std::index_sequence<Is...> const &) {
-        function(vArgs[Is].getAs<Args>()...);
+    template<typename A>
+    INLINE void encode_out_arg(Payload& buffer, arg_value_t<A>& arg){
+        if constexpr(is_out_arg_v<A>){
+            if constexpr(std::is_class_v<arg_value_t<A>>)
+                stream::write(buffer, &arg);//length prefixed
+            else
+                stream::write(buffer, arg);
+        }
+    }
+
+    //Decodes the input arguments from data, calls the function and encodes the return value
+    //and the output arguments back in data. Returns false, without calling the function, when the
+    //input arguments are truncated.
+    template<typename R, typename... Args>
+    bool marshall_typed(R(*function)(Args...), Payload& data){
+        //scratch arguments: strings and blobs keep their capacity across the calls
+        SCRATCH_STORAGE std::tuple<arg_value_t<Args>...> args;
+        [[maybe_unused]] const unsigned char* p = data.data();
+        [[maybe_unused]] const unsigned char* const end = data.data() + data.size();
+        if(!std::apply([&p, end](auto&... arg){ return (decode_arg(p, end, arg) && ... && true); }, args))
+            return false;
+        //the input arguments have been decoded: the payload is reused for the output ones
+        if constexpr (std::is_same<R,void>::value){
+            std::apply([function](auto&... arg){ function(pass_arg<Args>(arg)...); }, args);
+            data.clear();
+            data.reserve(std::apply([](auto&... arg){ return ((is_out_arg_v<Args> ? encoded_size(arg) : 0) + ... + 0); }, args));
+        }
+        else{
+            R returned_value = std::apply([function](auto&... arg){ return function(pass_arg<Args>(arg)...); }, args);
+            data.clear();
+            data.reserve(encoded_size(returned_value) + std::apply([](auto&... arg){ return ((is_out_arg_v<Args> ? encoded_size(arg) : 0) + ... + 0); }, args));
+            stream::write(data, returned_value);
+        }
+        std::apply([&data](auto&... arg){ (encode_out_arg<Args>(data, arg), ...); }, args);
+        return true;
     }
 
     /**
@@ -495,59 +617,61 @@ namespace rpc
     */
 
     //Client side: from assign data from stream to args_out addresses
+    //The output arguments start at the ix token (text) or byte (binary) of data.
+    //Returns false when the output arguments are truncated.
     template<typename D>
-    [[maybe_unused]] static void deserialize_out_args(const std::vector<OutArgTypeId>& format, D& data, const std::vector<void*>& addresses){}
+    [[maybe_unused]] static bool deserialize_out_args(OutFormat format, D& data, const OutArgsAddresses& addresses, size_t ix){ return false; }
 
     template<>
-    [[maybe_unused]] void deserialize_out_args(const std::vector<OutArgTypeId>& format, std::vector<std::string>& data, const std::vector<void*>& addresses){
-        for(int i = 0; i < format.size(); ++i) {
+    [[maybe_unused]] bool deserialize_out_args(OutFormat format, std::vector<std::string_view>& data, const OutArgsAddresses& addresses, size_t ix){
+        for(size_t i = 0; i < format.size(); ++i, ++ix) {
+            if(ix >= data.size())
+                return false;//one token per output argument
             switch (format[i])
             {
                 case OutArgTypeId::INT_REF:
                 {
-                    int iconv;
-                    stream::read(data[i], iconv);
+                    int iconv{};
+                    stream::read(data[ix], iconv);
                     int *p = reinterpret_cast<int*>(addresses[i]);
                     *p = iconv;
                 }
                     break;
                 case OutArgTypeId::LONG_REF:
                 {
-                    long lconv;
-                    stream::read(data[i], lconv);
+                    long lconv{};
+                    stream::read(data[ix], lconv);
                     long *p = reinterpret_cast<long*>(addresses[i]);
                     *p = lconv;
                 }
                     break;
                 case OutArgTypeId::FLOAT_REF:
                 {
-                    float fconv;
-                    stream::read(data[i], fconv);
+                    float fconv{};
+                    stream::read(data[ix], fconv);
                     auto p = reinterpret_cast<float*>(addresses[i]);
                     *p = fconv;
                 }
                     break;
                 case OutArgTypeId::STRING_REF:
                 {
-                    std::string s;
-                    stream::read(data[i], s);
                     auto p = reinterpret_cast<std::string*>(addresses[i]);
-                    *p = s;
+                    stream::read(data[ix], *p);
                 }
                     break;
 #if P64
                 case OutArgTypeId::LONGLONG_REF:
                 {
-                    long long llconv;
-                    stream::read(data[i], llconv);
+                    long long llconv{};
+                    stream::read(data[ix], llconv);
                     auto p = reinterpret_cast<long long*>(addresses[i]);
                     *p = llconv;
                 }
                     break;
                 case OutArgTypeId::DOUBLE_REF:
                 {
-                    double dconv;
-                    stream::read(data[i], dconv);
+                    double dconv{};
+                    stream::read(data[ix], dconv);
                     auto p = reinterpret_cast<double*>(addresses[i]);
                     *p = dconv;
                 }
@@ -557,19 +681,19 @@ namespace rpc
                     break;
             }
         }
+        return true;
     }
 
     template<>
-    [[maybe_unused]] void deserialize_out_args(const std::vector<OutArgTypeId>& format, std::vector<unsigned char>& data, const std::vector<void*>& addresses){
-        using DIFFERENCE_TYPE = std::vector<unsigned char>::difference_type;
-        DIFFERENCE_TYPE ix = 0;
-        for(int i = 0; i < format.size(); ++i) {
+    [[maybe_unused]] bool deserialize_out_args(OutFormat format, Payload& data, const OutArgsAddresses& addresses, size_t offset){
+        auto ix = (std::ptrdiff_t)offset;
+        for(size_t i = 0; i < format.size(); ++i) {
+            size_t n = 0;
             switch (format[i])
             {
                 case OutArgTypeId::INT_REF:
                 {   int iconv;
-                    stream::read(data.begin()+ix, iconv);
-                    ix += sizeof(int);
+                    n = stream::read(data.data()+ix, data.size()-ix, iconv);
                     int *p = reinterpret_cast<int*>(addresses[i]);
                     *p = iconv;
                 }
@@ -577,8 +701,7 @@ namespace rpc
                 case OutArgTypeId::LONG_REF:
                 {
                     long lconv;
-                    stream::read(data.begin()+ix, lconv);
-                    ix += sizeof(long);
+                    n = stream::read(data.data()+ix, data.size()-ix, lconv);
                     long *p = reinterpret_cast<long*>(addresses[i]);
                     *p = lconv;
                 }
@@ -586,8 +709,7 @@ namespace rpc
                 case OutArgTypeId::FLOAT_REF:
                 {
                     float fconv;
-                    stream::read(data.begin()+ix, fconv);
-                    ix += sizeof(float);
+                    n = stream::read(data.data()+ix, data.size()-ix, fconv);
                     auto p = reinterpret_cast<float*>(addresses[i]);
                     *p = fconv;
                 }
@@ -595,8 +717,7 @@ namespace rpc
                 case OutArgTypeId::STRING_REF:
                 {
                     std::string s;
-                    stream::read(data.begin()+ix, s);
-                    ix += (DIFFERENCE_TYPE)(sizeof(SIZE_T) + s.size());
+                    n = stream::read(data.data()+ix, data.size()-ix, s);
                     auto *p = reinterpret_cast<std::string*>(addresses[i]);
                     *p = s;
                 }
@@ -605,19 +726,31 @@ namespace rpc
                 case OutArgTypeId::BLOB_REF:
                 {
                     blob v;
-                    stream::read(data.begin()+ix, v);
-                    ix += (DIFFERENCE_TYPE)(sizeof(SIZE_T) + v.size());
+                    n = stream::read(data.data()+ix, data.size()-ix, v);
                     blob* p = reinterpret_cast<blob*>(addresses[i]);
                     *p = v;
                 }
                     break;
+                case OutArgTypeId::SHORT_ARRAY_REF:
+                    n = decode_array_out_arg<short>(data, ix, addresses[i]);
+                    break;
+                case OutArgTypeId::INT_ARRAY_REF:
+                    n = decode_array_out_arg<int>(data, ix, addresses[i]);
+                    break;
+                case OutArgTypeId::FLOAT_ARRAY_REF:
+                    n = decode_array_out_arg<float>(data, ix, addresses[i]);
+                    break;
+#if P64
+                case OutArgTypeId::DOUBLE_ARRAY_REF:
+                    n = decode_array_out_arg<double>(data, ix, addresses[i]);
+                    break;
+#endif
 #endif
 #if P64
                 case OutArgTypeId::LONGLONG_REF:
                 {
                     long long llconv;
-                    stream::read(data.begin()+ix, llconv);
-                    ix += sizeof(long long);
+                    n = stream::read(data.data()+ix, data.size()-ix, llconv);
                     auto p = reinterpret_cast<long long*>(addresses[i]);
                     *p = llconv;
                 }
@@ -625,69 +758,83 @@ namespace rpc
                 case OutArgTypeId::DOUBLE_REF:
                 {
                     double dconv;
-                    stream::read(data.begin()+ix, dconv);
-                    ix += sizeof(double);
+                    n = stream::read(data.data()+ix, data.size()-ix, dconv);
                     auto p = reinterpret_cast<double*>(addresses[i]);
                     *p = dconv;
                 }
                     break;
 #endif
                 default:
-                    break;
+                    continue;//no output value
             }
+            if(n == 0)
+                return false;//truncated
+            ix += n;
         }
+        return true;
     }
 
     /**
     * Codification
+    * A connected function is identified by the 32 bits FNV-1a hash of its prototype and described by
+    * format tables. Both are computed at compile time: no allocation at connect time.
+    * A second hash of the prototype, from another offset basis, tells apart the prototypes colliding on the id.
     */
 
-    static std::string string_composer (const std::initializer_list<std::string>& strings) {
-        std::stringstream ss_composition;
+    using PrototypeId = uint32_t;
 
-        std::initializer_list<std::string>::iterator it = strings.begin();
-        ss_composition << it[0];//first string without separator
-        for(int i = 1; i < strings.size(); ++i){
-            ss_composition << " " << it[i];
-        }
-        return ss_composition.str();
-    }
+    constexpr PrototypeId FNV_OFFSET_BASIS = 2166136261u;
+    constexpr PrototypeId FNV_PRIME = 16777619u;
 
-    template <typename ...Args>
-    std::string stringify(){
-        return string_composer({ParamType<Args>::name...});
+    //FNV-1a hash of s continuing from h
+    constexpr PrototypeId fnv1a(const char* s, PrototypeId h = FNV_OFFSET_BASIS){
+        while(*s != '\0'){
+            h ^= (unsigned char)*s++;
+            h *= FNV_PRIME;
+        }
+        return h;
     }
 
+    constexpr PrototypeId FNV_CHECK_BASIS = fnv1a("bmRPC");
+
+    //Format table: the ids different from WRONG, in the parameters order
+    template<typename E, E... ids>
+    struct FormatTable{
+        static constexpr size_t size = ((ids != E::WRONG ? 1 : 0) + ... + 0);
+        static constexpr std::array<E, size> make(){
+            std::array<E, size> table{};
+            size_t n = 0;
+            ((ids != E::WRONG ? (void)(table[n++] = ids) : (void)0), ...);
+            return table;
+        }
+        static constexpr std::array<E, size> table = make();
+    };
 
-    static auto codify_in_args_impl (const std::initializer_list<InArgTypeId>& ids) {
-        std::vector<InArgTypeId> args;
-        std::initializer_list<InArgTypeId>::iterator it = ids.begin();
-        for(int i = 0; i < ids.size(); ++i){
-            if(it[i] != InArgTypeId::WRONG)
-                args.push_back(it[i]);
+    template<typename R, typename... Args>
+    struct Signature{
+        //hash of the space separated return and parameter type names
+        static constexpr PrototypeId make_hash(PrototypeId basis = FNV_OFFSET_BASIS){
+            PrototypeId h = fnv1a(ParamType<R>::name, basis);
+            ((h = fnv1a(ParamType<Args>::name, fnv1a(" ", h))), ...);
+            return h;
         }
-        return args;
-    }
+        static constexpr PrototypeId hash = make_hash();
 
-    template <typename ...Args>
-    static auto codify_in_args(){
-        return codify_in_args_impl({ParamType<Args>::in_id...});
-    }
+        //prototype id: the signature hash continued by the function name.
+        //Evaluated at compile time for the string literal given by CONNECT.
+        static constexpr PrototypeId id(const char* name){
+            return fnv1a(name, fnv1a(" ", hash));
+        }
 
-    static auto codify_out_args_impl (const std::initializer_list<OutArgTypeId>& ids) {
-        std::vector<OutArgTypeId> args;
-        std::initializer_list<OutArgTypeId>::iterator it = ids.begin();
-        for(int i = 0; i < ids.size(); ++i){
-            if(it[i] != OutArgTypeId::WRONG)
-                args.push_back(it[i]);
+        //prototype check: the same prototype hashed from FNV_CHECK_BASIS. It is never sent.
+        static constexpr PrototypeId check_hash = make_hash(FNV_CHECK_BASIS);
+        static constexpr PrototypeId check(const char* name){
+            return fnv1a(name, fnv1a(" ", check_hash));
         }
-        return args;
-    }
 
-    template <typename ...Args>
-    static auto codify_out_args(){
-        return codify_out_args_impl({ParamType<Args>::out_id...});
-    }
+        static constexpr InFormat in_format{FormatTable<InArgTypeId, ParamType<Args>::in_id...>::table};
+        static constexpr OutFormat out_format{FormatTable<OutArgTypeId, ParamType<Args>::out_id...>::table};
+    };
 
     /**
     * ParamTraits
@@ -705,6 +852,7 @@ namespace rpc
     struct ParamTraits<R(Args...)>{
         //Number of the parameters of the function signature
         static constexpr std::size_t arity = sizeof...(Args);
+        using return_type = R;
         //Validity of the parameters of the function signature
         [[maybe_unused]] static constexpr bool valid = ReturnType<R>::valid && ((ParamType<Args>::valid) && ...);
         template <std::size_t N>
@@ -722,7 +870,7 @@ namespace rpc
     struct Arguments
     {
         template<typename V, typename S>
-        static void serialize_impl(V& v,S&) {}
+        static void serialize_impl(V&, S&) {}
         template<typename V, typename S, typename First, typename... Rest>
         [[maybe_unused]] static void serialize_impl(V& v, S& s, First&& first, Rest&& ... rest)
         {
@@ -745,7 +893,8 @@ namespace rpc
 
             if constexpr(std::is_reference_v<ParamTrait>
                          && (std::is_same_v<std::string, par_base_type>
-                             || std::is_same_v<std::vector<unsigned char>, par_base_type>)){
+                             || std::is_same_v<std::vector<unsigned char>, par_base_type>
+                             || is_array_arg_v<par_base_type>)){
                 auto p = std::addressof(first);
                 stream::write(s,p);
             }
@@ -767,6 +916,8 @@ namespace rpc
     static void serialize_args(V& v,S& s, Args&& ... args)
     {
         static_assert(ParamTraits<F>::arity == sizeof...(Args), "Invalid number of parameters for RPC call.");
+        if constexpr(!std::is_same_v<S, std::string>)
+            s.reserve(s.size() + (encoded_size(args) + ... + 0));//exact frame payload size
         Arguments<F, 0>::serialize_impl(v,s, std::forward<Args>(args)...);
     }
 
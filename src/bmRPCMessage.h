@@ -24,6 +24,18 @@ namespace bm
 {
 namespace rpc
 {
+    //Reserved method ids. User method ids are allocated from 0 upwards.
+    //BIND: the id field carries the method id to bind, the payload carries the function prototype.
+    //The server answers with the same method id and a one item status payload (1 resolved, 0 unknown).
+    constexpr METHOD_ID_T METHOD_ID_BIND = std::numeric_limits<METHOD_ID_T>::max();
+    //BATCH: the payload carries a sequence of sub-messages (see Batch below).
+    constexpr METHOD_ID_T METHOD_ID_BATCH = METHOD_ID_BIND - 1;
+    //BUSY: reply to a request rejected by the server flow control. The id field is the request one, the payload is empty.
+    constexpr METHOD_ID_T METHOD_ID_BUSY = METHOD_ID_BIND - 2;
+
+    //Binary payload storage: fixed capacity in heap-less mode.
+    using Payload = std::conditional_t<HEAP_LESS, StaticVector<unsigned char, MAX_MSG_PAYLOAD_SIZE>, std::vector<unsigned char>>;
+
     template <typename D>
     class Message {};
 
@@ -38,36 +50,58 @@ namespace rpc
 
         //the message is composed of:
         //id: null terminated string.
-        //rpc name: null terminated string.
+        //rpc method id: null terminated string.
         //payload (args values): null terminated string.
 
         Message() = default;
 
-        [[nodiscard]] const std::string & getName() const {
-            return m_name;
+        [[nodiscard]] const std::string& getMethod() const {
+            return m_method;
+        }
+
+        void getMethod(METHOD_ID_T& method) const {
+            std::from_chars(m_method.data(), m_method.data() + m_method.size(), method);
+        }
+
+        void setMethod(const METHOD_ID_T& method){
+            m_method = std::to_string(method);
         }
 
-        void setName(std::string& name){
-            m_name = name;
+        void setMethod(std::string& method){
+            m_method = method;
         }
 
         [[nodiscard]] const std::string& getValue() const {
             return m_value;
         }
 
+        [[nodiscard]] std::string& getValue() {
+            return m_value;
+        }
+
         void setValue(std::string& value){
             m_value = std::move(value);
         }
 
+        void setValue(std::string&& value){
+            m_value = std::move(value);
+        }
+
+        //The text payload grows as needed.
+        [[nodiscard]] constexpr bool overflow() const {
+            return false;
+        }
+
         [[nodiscard]] const std::string& getId() const {
             return m_id;
         }
 
-        void getId(uint16_t& id) const {
+        template<typename T>
+        void getId(T& id) const {
             std::from_chars(m_id.data(), m_id.data() + m_id.size(), id);
         }
 
-        void setId(uint16_t& id) {
+        void setId(INVOKATION_ID_T id) {
             m_id = std::to_string(id);
         }
 
@@ -76,7 +110,7 @@ namespace rpc
         }
 
     private:
-        std::string m_name;
+        std::string m_method;
         std::string m_id;
         std::string m_value;
     };
@@ -92,56 +126,225 @@ namespace rpc
     public:
 
         //the message is composed of:
-        //id: word (uint6_t)
-        //rpc name: 0 terminated string.
-        //payload (args values): vector<unsigned char>.
+        //id: INVOKATION_ID_T
+        //rpc method id: METHOD_ID_T
+        //payload (args values): Payload (vector<unsigned char> or fixed capacity in heap-less mode).
 
-        Message():m_id(0){};
+        Message():m_method(0),m_id(0){};
+
+        [[nodiscard]] const METHOD_ID_T& getMethod() const {
+            return m_method;
+        }
 
-        [[nodiscard]] const std::string& getName() const {
-            return m_name;
+        void setMethod(const METHOD_ID_T& method){
+            m_method = method;
         }
 
-        void setName(std::string& name){
-            m_name = name;
+        [[nodiscard]] const Payload& getValue() const {
+            return m_value;
         }
 
-        [[nodiscard]] const std::vector<unsigned char>& getValue() const {
+        //In place access: the payload is encoded and decoded without copies.
+        [[nodiscard]] Payload& getValue() {
             return m_value;
         }
 
-        void setValue(std::vector<unsigned char>& value){
+        void setValue(Payload& value){
             m_value = value;
         }
 
+        void setValue(Payload&& value){
+            m_value = std::move(value);
+        }
+
+        //clear() keeps the capacity of the pooled messages
         void resetValue(){
             m_value.clear();
         }
 
         void writeValue(const unsigned char* pvalue, size_t size){
-            for (int i = 0; i < size; ++i,++pvalue) {
-                m_value.push_back(*pvalue);
-            }
+            m_value.insert(m_value.end(), pvalue, pvalue + size);
+        }
+
+        //True when the payload exceeded the heap-less capacity and has been truncated.
+        [[nodiscard]] bool overflow() const {
+#if HEAP_LESS
+            return m_value.overflow();
+#else
+            return false;
+#endif
         }
 
         [[nodiscard]] size_t getSize() const {
             return m_value.size();
         }
 
-        [[nodiscard]] const uint16_t& getId() const {
+        [[nodiscard]] const INVOKATION_ID_T& getId() const {
             return m_id;
         }
 
-        void setId(uint16_t& value) {
+        void setId(INVOKATION_ID_T value) {
             m_id = value;
         }
 
     private:
-        std::string m_name;
-        uint16_t m_id{};
-        std::vector<unsigned char> m_value;
+        METHOD_ID_T m_method{};
+        INVOKATION_ID_T m_id{};
+        Payload m_value;
     };
 
+    template <typename D>
+    using MsgPool = StaticPool<Message<D>, MSG_POOL_SIZE>;
+    using MsgHandle = PoolHandle;
+    constexpr MsgHandle NO_MSG = NO_HANDLE;
+    using MsgQueue = FixedQueue<MsgHandle, MSG_POOL_SIZE>;
+
+    /**
+     * Header fields
+     * [binary type]
+     * Invokation id, method id and payload size: fixed width, or varints with COMPACT_ENCODING.
+     */
+
+    constexpr size_t MAX_FIELD_SIZE = COMPACT_ENCODING ? MAX_VARINT_SIZE : std::max(sizeof(size_t), sizeof(INVOKATION_ID_T));
+
+    //Encodes a header field at p. Returns the encoded size.
+    template<typename T>
+    INLINE size_t encode_field(unsigned char* p, T value){
+        if constexpr(COMPACT_ENCODING)
+            return encode_varint(p, value);
+        else{
+            std::memcpy(p, &value, sizeof(T));
+            return sizeof(T);
+        }
+    }
+
+    //Decodes a header field from at most n bytes at p. Returns the decoded size, 0 when truncated.
+    template<typename T>
+    INLINE size_t decode_field(const unsigned char* p, size_t n, T& value){
+        if constexpr(COMPACT_ENCODING)
+            return decode_varint(p, n, value);
+        else{
+            if(n < sizeof(T))
+                return 0;
+            std::memcpy(&value, p, sizeof(T));
+            return sizeof(T);
+        }
+    }
+
+    template<typename T>
+    INLINE size_t field_size(T value){
+        if constexpr(COMPACT_ENCODING)
+            return varint_size(value);
+        else
+            return sizeof(T);
+    }
+
+#if BATCHING
+    /**
+     * Batch
+     * [binary type]
+     * Each sub-message has the binary message layout: ID, METHOD, SIZE header fields and payload.
+     */
+
+    using BinaryMessage = Message<std::vector<unsigned char>>;
+
+    constexpr size_t BATCH_CAPACITY = HEAP_LESS && MAX_MSG_PAYLOAD_SIZE < MAX_BATCH_SIZE ? MAX_MSG_PAYLOAD_SIZE : MAX_BATCH_SIZE;
+
+    inline size_t batch_header_size(const BinaryMessage& msg){
+        return field_size(msg.getId()) + field_size(msg.getMethod()) + field_size(msg.getSize());
+    }
+
+    inline void batch_append(Payload& batch, const BinaryMessage& msg){
+        unsigned char header[3 * MAX_FIELD_SIZE];
+        size_t n = encode_field(header, msg.getId());
+        n += encode_field(header + n, msg.getMethod());
+        n += encode_field(header + n, msg.getSize());
+        batch.insert(batch.end(), header, header + n);
+        batch.insert(batch.end(), msg.getValue().begin(), msg.getValue().end());
+    }
+
+    //Decodes the sub-message at offset ix. Returns the offset of the next one, 0 when truncated.
+    inline size_t batch_extract(const Payload& batch, size_t ix, BinaryMessage& msg){
+        INVOKATION_ID_T id;
+        METHOD_ID_T method;
+        size_t size;
+        size_t n;
+        if((n = decode_field(batch.data() + ix, batch.size() - ix, id)) == 0)
+            return 0;
+        ix += n;
+        if((n = decode_field(batch.data() + ix, batch.size() - ix, method)) == 0)
+            return 0;
+        ix += n;
+        if((n = decode_field(batch.data() + ix, batch.size() - ix, size)) == 0)
+            return 0;
+        ix += n;
+        if(batch.size() - ix < size)
+            return 0;
+        msg.setId(id);
+        msg.setMethod(method);
+        msg.resetValue();
+        msg.writeValue(batch.data() + ix, size);
+        return ix + size;
+    }
+
+    //Skips the sub-message at ix. Returns the offset of the next one, 0 when truncated.
+    //has_id is set when the id field is whole, even if the rest of the sub-message is truncated.
+    inline size_t batch_skip(const Payload& batch, size_t ix, INVOKATION_ID_T& id, bool& has_id){
+        METHOD_ID_T method;
+        size_t size;
+        size_t n;
+        if((n = decode_field(batch.data() + ix, batch.size() - ix, id)) == 0)
+            return 0;
+        has_id = true;
+        ix += n;
+        if((n = decode_field(batch.data() + ix, batch.size() - ix, method)) == 0)
+            return 0;
+        ix += n;
+        if((n = decode_field(batch.data() + ix, batch.size() - ix, size)) == 0)
+            return 0;
+        ix += n;
+        if(batch.size() - ix < size)
+            return 0;
+        return ix + size;
+    }
+
+    //Coalesces the queued messages into batch frames, keeping their order.
+    //Messages bigger than a batch, or left when the pool is exhausted, are sent as they are.
+    inline void coalesce(MsgPool<std::vector<unsigned char>>& pool, MsgQueue& queue){
+        size_t n = queue.size();
+        if(n < 2)
+            return;
+        MsgHandle batch = NO_MSG;
+        while(n-- > 0){
+            MsgHandle handle = queue.front();
+            queue.pop();
+            const BinaryMessage& msg = pool[handle];
+            size_t size = batch_header_size(msg) + msg.getSize();
+            if(batch != NO_MSG && pool[batch].getSize() + size > BATCH_CAPACITY){
+                queue.push(batch);//full batch
+                batch = NO_MSG;
+            }
+            if(size > BATCH_CAPACITY){
+                queue.push(handle);
+                continue;
+            }
+            if(batch == NO_MSG){
+                if((batch = pool.acquire()) == NO_MSG){
+                    queue.push(handle);
+                    continue;
+                }
+                pool[batch].setId(0);
+                pool[batch].setMethod(METHOD_ID_BATCH);
+                pool[batch].resetValue();
+            }
+            batch_append(pool[batch].getValue(), msg);
+            pool.release(handle);
+        }
+        if(batch != NO_MSG)
+            queue.push(batch);
+    }
+#endif
+
 }//namespace rpc
 }//namespace bm
 
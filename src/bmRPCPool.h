@@ -0,0 +1,221 @@
+/*
+ *
+ * Copyright 2022 Claudio Lanfranchi.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef BMRPCPOOL_H
+#define BMRPCPOOL_H
+
+namespace bm
+{
+namespace rpc
+{
+    /**
+     * FixedQueue
+     * Fixed capacity FIFO circular buffer.
+     */
+
+    template <typename T, size_t N>
+    class FixedQueue{
+    public:
+
+        FixedQueue():m_items(),m_head(0),m_count(0){};
+
+        //Returns false when the queue is full.
+        bool push(const T& item){
+            if(full())
+                return false;
+            size_t tail = m_head + m_count;
+            if(tail >= N)
+                tail -= N;
+            m_items[tail] = item;
+            m_count++;
+            return true;
+        }
+
+        INLINE T& front(){
+            return m_items[m_head];
+        }
+
+        void pop(){
+            if(m_count > 0){
+                if(++m_head >= N)
+                    m_head = 0;
+                m_count--;
+            }
+        }
+
+        [[nodiscard]] INLINE bool empty() const {
+            return m_count == 0;
+        }
+
+        [[nodiscard]] INLINE bool full() const {
+            return m_count == N;
+        }
+
+        [[nodiscard]] INLINE size_t size() const {
+            return m_count;
+        }
+
+    private:
+        std::array<T, N> m_items;
+        size_t m_head;
+        size_t m_count;
+    };
+
+
+    /**
+     * StaticVector
+     * Fixed capacity contiguous container with the subset of the std::vector interface used by the codecs.
+     * Items pushed beyond the capacity are dropped and the overflow flag is raised until the next clear.
+     */
+
+    template <typename T, size_t N>
+    class StaticVector{
+    public:
+
+        using value_type = T;
+        using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        StaticVector():m_items(),m_size(0),m_overflow(false){};
+
+        void push_back(const T& item){
+            if(m_size < N)
+                m_items[m_size++] = item;
+            else
+                m_overflow = true;
+        }
+
+        //Only appending is supported.
+        template <typename It>
+        iterator insert([[maybe_unused]] const_iterator pos, It first, It last){
+            iterator it = end();
+            if constexpr(std::is_pointer_v<It>){
+                //contiguous range: bulk copy
+                auto n = (size_t)(last - first);
+                if(n > N - m_size){
+                    n = N - m_size;
+                    m_overflow = true;
+                }
+                std::copy(first, first + n, it);
+                m_size += n;
+            }
+            else{
+                for(; first != last; ++first)
+                    push_back(*first);
+            }
+            return it;
+        }
+
+        INLINE void clear(){
+            m_size = 0;
+            m_overflow = false;
+        }
+
+        //The capacity is fixed.
+        INLINE void reserve([[maybe_unused]] size_t n){}
+
+        //Growing beyond the capacity stops at the capacity and raises the overflow flag.
+        void resize(size_t n){
+            if(n > N){
+                n = N;
+                m_overflow = true;
+            }
+            for(size_t i = m_size; i < n; ++i)
+                m_items[i] = T();
+            m_size = n;
+        }
+
+        INLINE T& operator[](size_t ix){ return m_items[ix]; }
+        INLINE const T& operator[](size_t ix) const { return m_items[ix]; }
+
+        INLINE T* data(){ return m_items.data(); }
+        INLINE const T* data() const { return m_items.data(); }
+
+        INLINE iterator begin(){ return m_items.data(); }
+        INLINE iterator end(){ return m_items.data() + m_size; }
+        INLINE const_iterator begin() const { return m_items.data(); }
+        INLINE const_iterator end() const { return m_items.data() + m_size; }
+
+        [[nodiscard]] INLINE size_t size() const { return m_size; }
+        [[nodiscard]] INLINE constexpr size_t capacity() const { return N; }
+        [[nodiscard]] INLINE bool empty() const { return m_size == 0; }
+        [[nodiscard]] INLINE bool overflow() const { return m_overflow; }
+
+    private:
+        std::array<T, N> m_items;
+        size_t m_size;
+        bool m_overflow;
+    };
+
+
+    /**
+     * StaticPool
+     * Fixed set of objects addressed by handle.
+     * Released objects keep their storage so the steady state does not allocate.
+     */
+
+    using PoolHandle = size_t;
+    constexpr PoolHandle NO_HANDLE = std::numeric_limits<PoolHandle>::max();
+
+    template <typename T, size_t N>
+    class StaticPool{
+    public:
+
+        StaticPool():m_n_free(N){
+            //the lowest free handle is on top of the free list
+            for(size_t i = 0; i < N; ++i)
+                m_free[i] = N - 1 - i;
+        }
+
+        //Returns NO_HANDLE when the pool is exhausted.
+        PoolHandle acquire(){
+            if(m_n_free == 0)
+                return NO_HANDLE;
+            return m_free[--m_n_free];
+        }
+
+        void release(PoolHandle handle){
+            if(handle < N)
+                m_free[m_n_free++] = handle;
+        }
+
+        INLINE T& operator[](PoolHandle handle){
+            return m_items[handle];
+        }
+
+        [[maybe_unused]] [[nodiscard]] INLINE size_t available() const {
+            return m_n_free;
+        }
+
+    private:
+        std::array<T, N> m_items;
+        //free list used as a stack of handles
+        std::array<PoolHandle, N> m_free;
+        size_t m_n_free;
+    };
+
+}//namespace rpc
+}//namespace bm
+
+
+#endif // BMRPCPOOL_H
@@ -24,33 +24,45 @@ namespace bm
 {
 namespace rpc
 {
+    /**
+     * FunctionsRegistry
+     * Hashed registry: no capacity limit.
+     */
+
     template <typename T>
     class FunctionsRegistry{
     public:
 
+        //Returns nullptr when a different prototype is registered with the same id.
         T* insert(T& rpc){
-            std::string name = rpc.getName();
+            PrototypeId name = rpc.getPrototypeId();
             auto got = functions_map.find(name);
             if ( got != functions_map.end() ){
-                //rpc already registered
+                //rpc already registered, unless the prototype id collides
                 T* q = &(*got->second);
-                return q;
+                return q->isSamePrototype(rpc) ? q : nullptr;
             }
             //new rpc
             functions_list.push_front(std::move(rpc));
             auto p = functions_list.begin();
             T* q = &(*p);
-            functions_map.insert(make_pair(name,q));
+            functions_map.insert(std::make_pair(name,q));
+            auto free_index = std::find(functions_index.begin(), functions_index.end(), nullptr);
+            if(free_index != functions_index.end())
+                *free_index = q;
+            else
+                functions_index.push_back(q);
             return q;
         }
 
         void remove(T* rpc){
             if(rpc != nullptr){
-                std::string name = rpc->getName();
+                PrototypeId name = rpc->getPrototypeId();
                 this->functions_map.erase(name);
+                std::replace(functions_index.begin(), functions_index.end(), rpc, static_cast<T*>(nullptr));
                 auto pre_it = functions_list.before_begin();
                 for (auto it = functions_list.begin(); it != functions_list.end(); it++) {
-                    if (it->getName() == name) {
+                    if (it->getPrototypeId() == name) {
                         functions_list.erase_after(pre_it);
                         break;
                     }
@@ -59,15 +71,21 @@ namespace rpc
             }
         }
 
-        T* find(std::string name){
+        T* find(PrototypeId name) const {
             auto got = functions_map.find(name);
             if ( got != functions_map.end() )
                 return got->second;
             return nullptr;
         }
 
-        T* get(const std::string& name){
-            return functions_map[name];
+        INLINE T* at(size_t index) const {
+            if(index < functions_index.size())
+                return functions_index[index];
+            return nullptr;
+        }
+
+        size_t index(const T* rpc) const {
+            return std::find(functions_index.begin(), functions_index.end(), rpc) - functions_index.begin();
         }
 
         [[maybe_unused]] bool empty(){
@@ -77,11 +95,107 @@ namespace rpc
     private:
         //average O(1) search, insert, deletion via hash
         //needed for hash name access. Iterators change when rehashed.
-        std::unordered_map<std::string, T*> functions_map;
+        std::unordered_map<PrototypeId, T*> functions_map;
         //needed for pointer to element access. New elements are appended. No iterators change.
         std::forward_list<T> functions_list;
+        //needed for method id access. Removed elements leave a null entry to be reused.
+        std::vector<T*> functions_index;
+    };
+
+
+    /**
+     * IndexedFunctionsRegistry
+     * Direct-indexed registry: functions live in a contiguous table of stable slots addressed by method id.
+     * The name map is only used at connect time. In heap-less mode the slots are scanned instead.
+     */
+
+    template <typename T>
+    class IndexedFunctionsRegistry{
+    public:
+
+        IndexedFunctionsRegistry():m_used(),m_n_free(MAX_REGISTRY_SIZE){
+            //the lowest free slot is on top of the free list
+            for(size_t i = 0; i < MAX_REGISTRY_SIZE; ++i)
+                m_free[i] = MAX_REGISTRY_SIZE - 1 - i;
+        }
+
+        //Returns nullptr when the registry is full or a different prototype is registered with the same id.
+        T* insert(T& rpc){
+            T* q = find(rpc.getPrototypeId());
+            if(q != nullptr)
+                return q->isSamePrototype(rpc) ? q : nullptr;//rpc already registered, unless the prototype id collides
+            if(m_n_free == 0)
+                return nullptr;
+            size_t ix = m_free[--m_n_free];
+#if !HEAP_LESS
+            functions_map.insert(std::make_pair(rpc.getPrototypeId(),ix));
+#endif
+            m_slots[ix] = std::move(rpc);
+            m_used[ix] = true;
+            return &m_slots[ix];
+        }
+
+        void remove(T* rpc){
+            if(rpc != nullptr){
+                size_t ix = index(rpc);
+                if(ix < MAX_REGISTRY_SIZE && m_used[ix]){
+#if !HEAP_LESS
+                    functions_map.erase(rpc->getPrototypeId());
+#endif
+                    m_slots[ix] = T();
+                    m_used[ix] = false;
+                    m_free[m_n_free++] = ix;
+                }
+            }
+        }
+
+        T* find(PrototypeId name){
+#if HEAP_LESS
+            for(size_t ix = 0; ix < MAX_REGISTRY_SIZE; ++ix){
+                if(m_used[ix] && m_slots[ix].getPrototypeId() == name)
+                    return &m_slots[ix];
+            }
+#else
+            auto got = functions_map.find(name);
+            if ( got != functions_map.end() )
+                return &m_slots[got->second];
+#endif
+            return nullptr;
+        }
+
+        //O(1) dispatch by method id
+        INLINE T* at(size_t index){
+            if(index < MAX_REGISTRY_SIZE && m_used[index])
+                return &m_slots[index];
+            return nullptr;
+        }
+
+        INLINE size_t index(const T* rpc) const {
+            return rpc - m_slots.data();
+        }
+
+        [[maybe_unused]] bool empty(){
+            return m_n_free == MAX_REGISTRY_SIZE;
+        }
+
+    private:
+        std::array<T, MAX_REGISTRY_SIZE> m_slots;
+        std::array<bool, MAX_REGISTRY_SIZE> m_used;
+        //free list used as a stack of slot indexes
+        std::array<size_t, MAX_REGISTRY_SIZE> m_free;
+        size_t m_n_free;
+#if !HEAP_LESS
+        //connect time name access. It is never used by the dispatch.
+        std::unordered_map<PrototypeId, size_t> functions_map;
+#endif
     };
 
+    static_assert(MAX_REGISTRY_SIZE <= METHOD_ID_BUSY, "The registry size exceeds the method id range");
+
+    //Heap-less mode always uses the direct-indexed registry
+    template <typename T>
+    using Registry = typename std::conditional<INDEXED_REGISTRY || HEAP_LESS, IndexedFunctionsRegistry<T>, FunctionsRegistry<T>>::type;
+
 }//namespace rpc
 }//namespace bm
 
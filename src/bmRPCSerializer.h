@@ -68,10 +68,10 @@ namespace rpc
                 {
                     size_t count = m_streamer.write(&m_p[m_i], m_len);
                     if(count >= m_len){
-                        m_len = m_pmsg->getName().size() + 1;
-                        m_p = m_pmsg->getName().c_str();
+                        m_len = m_pmsg->getMethod().size() + 1;
+                        m_p = m_pmsg->getMethod().c_str();
                         m_i = 0;
-                        m_tx_phase = NAME;
+                        m_tx_phase = METHOD;
                         break;
                     }
                     else{
@@ -80,7 +80,7 @@ namespace rpc
                     }
                 }
                     break;
-                case NAME:
+                case METHOD:
                 {
                     size_t count = m_streamer.write(&m_p[m_i], m_len);
                     if(count >= m_len){
@@ -125,7 +125,7 @@ namespace rpc
         enum TX_PHASE{
             IDLE = 0,
             ID,
-            NAME,
+            METHOD,
             ARGS_VALUE,
             END
         }m_tx_phase = IDLE;
@@ -146,18 +146,14 @@ namespace rpc
                 m_len(0),
                 m_p(nullptr),
                 m_i(0),
-                m_id(0),
-                m_size(0),
+                m_field(),
                 m_pmsg(nullptr),
                 m_tx_phase(IDLE){};
 
         void init(const Message<std::vector<unsigned char>>* pmsg){
             if(pmsg  != nullptr) {
                 m_pmsg = pmsg;
-                m_id = m_pmsg->getId();
-                m_len = sizeof(m_id);
-                m_p = reinterpret_cast<const unsigned char*>(&m_id);
-                m_i = 0;
+                set_field(m_pmsg->getId());
                 m_tx_phase = ID;
             }
         }
@@ -171,10 +167,8 @@ namespace rpc
                 {
                     size_t count = m_streamer.write(&m_p[m_i], m_len);
                     if(count >= m_len){
-                        m_len = m_pmsg->getName().size() + 1;
-                        m_p = reinterpret_cast<const unsigned char*>(m_pmsg->getName().c_str());
-                        m_i = 0;
-                        m_tx_phase = NAME;
+                        set_field(m_pmsg->getMethod());
+                        m_tx_phase = METHOD;
                         break;
                     }
                     else{
@@ -183,14 +177,11 @@ namespace rpc
                     }
                 }
                     break;
-                case NAME:
+                case METHOD:
                 {
                     size_t count = m_streamer.write(&m_p[m_i], m_len);
                     if(count >= m_len){
-                        m_size = m_pmsg->getSize();
-                        m_len = sizeof(m_size);
-                        m_p = reinterpret_cast<const unsigned char*>(&m_size);
-                        m_i = 0;
+                        set_field(m_pmsg->getSize());
                         m_tx_phase = SIZE;
                         break;
                     }
@@ -241,17 +232,24 @@ namespace rpc
         }
 
     private:
+        //The next bytes to send are the encoded header field
+        template<typename T>
+        INLINE void set_field(T value){
+            m_len = encode_field(m_field.data(), value);
+            m_p = m_field.data();
+            m_i = 0;
+        }
+
         Streamer<unsigned char, C>& m_streamer;
         const Message<std::vector<unsigned char>>* m_pmsg;
         const unsigned char *m_p;
         size_t m_i;
         size_t m_len;
-        size_t m_size;
-        uint16_t m_id;
+        std::array<unsigned char, MAX_FIELD_SIZE> m_field;//header field being sent
         enum TX_PHASE{
             IDLE = 0,
             ID,
-            NAME,
+            METHOD,
             SIZE,
             ARGS_VALUE,
             END
@@ -276,14 +274,13 @@ namespace rpc
     public:
         //the message is composed of:
         //id
-        //rpc name: 0 terminated string.
+        //rpc method id: 0 terminated string.
         //payload
         // args format: 0 terminated string.
         // args values: 0 terminated string.
 
         [[maybe_unused]] explicit Deserializer(Streamer<char, C>& s):
                 m_streamer(s),
-                m_len(0),
                 m_s(),
                 m_pmsg(nullptr),
                 m_rx_phase(IDLE){};
@@ -291,89 +288,33 @@ namespace rpc
         [[maybe_unused]] void init(Message<std::string>* pmsg){
             if(pmsg != nullptr) {
                 m_pmsg = pmsg;
-                m_len = 0;
                 m_s.clear();
                 m_rx_phase = ID;
             }
         }
 
+        //The message is parsed in place from the streamer spans and the parsed bytes are consumed.
         bool receive(){
             if(m_rx_phase != IDLE && m_rx_phase != END)
             {
-                m_len = m_streamer.rx_size();
-                if(m_len <= 0) return false;
-
-                char buffer[m_len+1];
-                m_streamer.try_read(buffer, m_len);
-                buffer[m_len] = 0;
-                char* p = buffer;
-                size_t ix = 0;
-
-                while(ix < m_len){
-                    switch(m_rx_phase){
-                        case IDLE:
-                        case END:
-                            break;
-                        case ID:
-                            for(size_t i = 0; i < m_len - ix; ++i){
-                                if(p[i] == 0){
-                                    m_s += std::string(p);
-                                    m_pmsg->setId(m_s);
-                                    m_s.clear();
-                                    m_rx_phase = NAME;
-                                    m_streamer.consume_read(i+1);
-                                    ix += i+1;
-                                    p = &buffer[ix];
-                                    break;
-                                }
-                            }
-                            //No string delimiter found. Consumes all the bytes.
-                            if(m_rx_phase == ID){
-                                m_s += std::string(p);
-                                m_streamer.consume_read(m_len);
-                                ix = m_len;
-                            }
-                            break;
-                        case NAME:
-                            for(size_t i = 0; i < m_len - ix; ++i){
-                                if(p[i] == 0){
-                                    m_s += std::string(p);
-                                    m_pmsg->setName(m_s);
-                                    m_s.clear();
-                                    m_rx_phase = ARGS_VALUE;
-                                    m_streamer.consume_read(i+1);
-                                    ix += i+1;
-                                    p = &buffer[ix];
-                                    break;
-                                }
-                            }
-                            if(m_rx_phase == NAME){
-                                m_s += std::string(p);
-                                m_streamer.consume_read(m_len - ix);
-                                ix = m_len;
-                            }
-                            break;
-                        case ARGS_VALUE:
-                            for(size_t i = 0; i < m_len - ix; ++i){
-                                if(p[i] == 0){
-                                    m_s += std::string(p);
-                                    m_pmsg->setValue(m_s);
-                                    m_s.clear();
-                                    m_rx_phase = END;
-                                    m_streamer.consume_read(i+1);
-                                    ix = m_len; // exit loop
-                                    break;
-                                }
-                            }
-                            if(m_rx_phase == ARGS_VALUE){
-                                m_s += std::string(p);
-                                m_streamer.consume_read(m_len - ix);
-                                ix = m_len;
-                            }
-                            break;
+                const char* span[2];
+                size_t len[2];
+                if(m_streamer.peek(span[0], len[0], span[1], len[1]) == 0)
+                    return false;
+
+                size_t consumed = 0;
+                for(size_t i = 0; i < 2 && m_rx_phase != END; ++i){
+                    const char* p = span[i];
+                    size_t n = len[i];
+                    while(n > 0 && m_rx_phase != END){
+                        size_t used = parse(p, n);
+                        p += used;
+                        n -= used;
+                        consumed += used;
                     }
-
                 }
+                m_streamer.consume_read(consumed);
+
                 if(m_rx_phase == END){
                     m_rx_phase = IDLE;
                     return true;
@@ -383,14 +324,43 @@ namespace rpc
         }
 
     private:
+        //Parses the current field from n available bytes. Returns the used bytes.
+        size_t parse(const char* p, size_t n){
+            auto end = static_cast<const char*>(std::memchr(p, 0, n));
+            if(end == nullptr){
+                //No string delimiter found. Consumes all the bytes.
+                m_s.append(p, n);
+                return n;
+            }
+            m_s.append(p, end - p);
+            switch(m_rx_phase){
+                case ID:
+                    m_pmsg->setId(m_s);
+                    m_rx_phase = METHOD;
+                    break;
+                case METHOD:
+                    m_pmsg->setMethod(m_s);
+                    m_rx_phase = ARGS_VALUE;
+                    break;
+                case ARGS_VALUE:
+                    m_pmsg->setValue(m_s);
+                    m_rx_phase = END;
+                    break;
+                case IDLE:
+                case END:
+                    break;
+            }
+            m_s.clear();
+            return end - p + 1;
+        }
+
         Streamer<char, C>& m_streamer;
         Message<std::string>* m_pmsg;
         std::string m_s;
-        size_t m_len;
         enum RX_PHASE{
             IDLE = 0,
             ID,
-            NAME,
+            METHOD,
             ARGS_VALUE,
             END
         }m_rx_phase = IDLE;
@@ -407,120 +377,44 @@ namespace rpc
 
         [[maybe_unused]] explicit Deserializer(Streamer<unsigned char, C>& s):
                 m_streamer(s),
-                m_len(0),
+                m_field(),
+                m_field_len(0),
                 m_size(0),
-                m_s(),
+                m_received(0),
                 m_pmsg(nullptr),
                 m_rx_phase(IDLE){};
 
         void init(Message<std::vector<unsigned char>>* pmsg){
             if(pmsg != nullptr) {
                 m_pmsg = pmsg;
-                m_len = 0;
-                m_s.clear();
-                m_v.clear();
+                m_field_len = 0;
                 m_rx_phase = ID;
             }
         }
 
+        //The message is parsed in place from the streamer spans and the parsed bytes are consumed.
+        //Only the payload is copied, once, into the message.
         bool receive(){
             if(m_rx_phase != IDLE && m_rx_phase != END)
             {
-                m_len = m_streamer.rx_size();
-                if(m_len <= 0) return false;
-
-                unsigned char buffer[m_len+1];
-                m_streamer.try_read(buffer, m_len);
-                buffer[m_len] = 0;//needed to terminate incomplete string
-                unsigned char* p = buffer;
-                size_t ix = 0;
-
-                while(ix < m_len){
-                    switch(m_rx_phase){
-                        case IDLE:
-                        case END:
-                            break;
-                        case ID:
-                            if(m_len - ix + m_v.size() >= sizeof(uint16_t)){
-                                size_t n = sizeof(uint16_t) - m_v.size();
-                                m_v.insert(m_v.end(), p, p + n);
-                                m_pmsg->setId(*reinterpret_cast<uint16_t*>(m_v.data()));
-                                m_rx_phase = NAME;
-                                m_streamer.consume_read(n);
-                                m_v.clear();
-                                ix += n;
-                                p = &buffer[ix];
-                            }
-                            else //Not enough read bytes.Consumes read bytes and read more.
-                            {
-                                m_v.insert(m_v.end(), p, p + (m_len - ix));
-                                m_streamer.consume_read(m_len - ix);
-                                ix = m_len;
-                            }
-                            break;
-                        case NAME:
-                            for(size_t i = 0; i < m_len - ix; ++i){
-                                if(p[i] == 0){
-                                    m_s += std::string(reinterpret_cast<const char*>(p));
-                                    m_pmsg->setName(m_s);
-                                    m_rx_phase = SIZE;
-                                    m_streamer.consume_read(i+1);
-                                    ix += i+1;
-                                    p = &buffer[ix];
-                                    break;
-                                }
-                            }
-                            if(m_rx_phase == NAME){
-                                m_s += std::string(reinterpret_cast<const char*>(p));
-                                m_streamer.consume_read(m_len - ix);
-                                ix = m_len;
-                            }
-                            break;
-                        case SIZE:
-                            if(m_len - ix + m_v.size() >= sizeof(size_t)){
-                                size_t n = sizeof(size_t) - m_v.size();
-                                m_v.insert(m_v.end(), p, p + n);
-                                m_size = *reinterpret_cast<size_t*>(m_v.data());
-                                m_streamer.consume_read(n);
-                                m_pmsg->resetValue();
-                                if(m_size > 0)
-                                {
-                                    ix += n;
-                                    p = &buffer[ix];
-                                    m_rx_phase = ARGS_VALUE;
-                                }
-                                else
-                                {
-                                    ix = m_len;
-                                    m_rx_phase = END;
-                                }
-
-                            }
-                            else
-                            {
-                                m_v.insert(m_v.end(), p, p + (m_len - ix));
-                                m_streamer.consume_read(m_len - ix);
-                                ix = m_len;
-                            }
-                            break;
-                        case ARGS_VALUE:
-                            if(m_len - ix + m_pmsg->getSize() >= m_size){
-                                size_t n = m_size - m_pmsg->getSize();
-                                m_pmsg->writeValue(reinterpret_cast<unsigned char*>(p), n);
-                                m_rx_phase = END;
-                                m_streamer.consume_read(n);
-                                ix = m_len; // exit loop
-                            }
-                            else
-                            {
-                                m_pmsg->writeValue(reinterpret_cast<unsigned char*>(p), m_len - ix);
-                                m_streamer.consume_read(m_len - ix);
-                                ix = m_len;
-                            }
-                            break;
+                const unsigned char* span[2];
+                size_t len[2];
+                if(m_streamer.peek(span[0], len[0], span[1], len[1]) == 0)
+                    return false;
+
+                size_t consumed = 0;
+                for(size_t i = 0; i < 2 && m_rx_phase != END; ++i){
+                    const unsigned char* p = span[i];
+                    size_t n = len[i];
+                    while(n > 0 && m_rx_phase != END){
+                        size_t used = parse(p, n);
+                        p += used;
+                        n -= used;
+                        consumed += used;
                     }
-
                 }
+                m_streamer.consume_read(consumed);
+
                 if(m_rx_phase == END){
                     m_rx_phase = IDLE;
                     return true;
@@ -530,16 +424,80 @@ namespace rpc
         }
 
     private:
+        //Parses the current phase from n available bytes. Returns the used bytes.
+        size_t parse(const unsigned char* p, size_t n){
+            size_t used;
+            if(m_rx_phase == ARGS_VALUE){
+                //the received bytes are counted apart: a heap-less payload may be truncated
+                used = std::min(n, m_size - m_received);
+                m_pmsg->writeValue(p, used);
+                m_received += used;
+                if(m_received == m_size)
+                    m_rx_phase = END;
+                return used;
+            }
+
+            //header fields are gathered across the spans: fixed size, or up to the varint last byte
+            if constexpr(COMPACT_ENCODING){
+                used = 0;
+                bool last = false;
+                while(used < n && !last){
+                    last = !(p[used] & 0x80) || m_field_len + 1 == m_field.size();//a malformed varint ends at the field capacity
+                    m_field[m_field_len++] = p[used++];
+                }
+                if(!last)
+                    return used;
+            }
+            else{
+                size_t field_size = (m_rx_phase == ID) ? sizeof(INVOKATION_ID_T) : (m_rx_phase == METHOD) ? sizeof(METHOD_ID_T) : sizeof(size_t);
+                used = std::min(n, field_size - m_field_len);
+                std::memcpy(m_field.data() + m_field_len, p, used);
+                m_field_len += used;
+                if(m_field_len < field_size)
+                    return used;
+            }
+            const size_t field_len = m_field_len;//a malformed varint decodes as 0
+            m_field_len = 0;
+            switch(m_rx_phase){
+                case ID:
+                {
+                    INVOKATION_ID_T id = 0;
+                    decode_field(m_field.data(), field_len, id);
+                    m_pmsg->setId(id);
+                    m_rx_phase = METHOD;
+                }
+                    break;
+                case METHOD:
+                {
+                    METHOD_ID_T method = 0;
+                    decode_field(m_field.data(), field_len, method);
+                    m_pmsg->setMethod(method);
+                    m_rx_phase = SIZE;
+                }
+                    break;
+                case SIZE:
+                    m_size = 0;
+                    decode_field(m_field.data(), field_len, m_size);
+                    m_pmsg->resetValue();
+                    m_received = 0;
+                    m_rx_phase = (m_size > 0) ? ARGS_VALUE : END;
+                    break;
+                default:
+                    break;
+            }
+            return used;
+        }
+
         Streamer<unsigned char, C>& m_streamer;
         Message<std::vector<unsigned char>>* m_pmsg;
-        std::string m_s;
-        std::vector<unsigned char> m_v;
-        size_t m_len;
+        std::array<unsigned char, MAX_FIELD_SIZE> m_field;//header field being received
+        size_t m_field_len;
         size_t m_size;
+        size_t m_received;
         enum RX_PHASE{
             IDLE = 0,
             ID,
-            NAME,
+            METHOD,
             SIZE,
             ARGS_VALUE,
             END
@@ -44,57 +44,107 @@ namespace rpc
 
 
         template<typename R, typename... Args>
-        Skeleton<D>* connect(const std::string& func_name, R(*func_address)(Args...)){
-            auto f_lambda = [func_address](Skeleton<D>* p_rpc) {
-                const size_t nargs = sizeof...(Args);
-                std::vector<AnyArg> vec;
-                vec = deserialize_in_args(p_rpc->in_args_format, p_rpc->in_args);
-                if constexpr (std::is_same<R,void>::value)//constexpr is required here
-                {
-                    callProcWithArgs(func_address, vec, std::make_index_sequence<nargs>{});
-                    if constexpr (std::is_same<D,std::string>::value){
-                        std::ostringstream ss;
-                        serialize_out_args<std::ostringstream>(p_rpc->in_args_format, vec,ss);
-                        p_rpc->out_args =  ltrim(ss.str());
-                    }
-                    else
-                    {
-                        p_rpc->out_args.clear();
-                        serialize_out_args<std::vector<unsigned char>>(p_rpc->in_args_format, vec, p_rpc->out_args);
-                    }
+        Skeleton<D>* connect(const char* func_name, R(*func_address)(Args...)){
+            static_assert(!HEAP_LESS || sizeof...(Args) <= MAX_ARGS, "The function exceeds MAX_ARGS arguments");
+            auto f_lambda = [func_address]([[maybe_unused]] Skeleton<D>* p_rpc, Message<D>& msg) {
+                if constexpr (typed_marshalling && !std::is_same<D,std::string>::value){
+                    //the signature selects the codec: no argument boxing nor format switches
+                    if(!marshall_typed(func_address, msg.getValue()))
+                        busy(msg);
                 }
                 else
                 {
-                    auto returned_value = callFuncWithArgs(func_address, vec, std::make_index_sequence<nargs>{});
-                    auto val = AnyArg(returned_value);
+                    const size_t nargs = sizeof...(Args);
+                    std::array<AnyArg, nargs> vec;
                     if constexpr (std::is_same<D,std::string>::value){
-                        std::ostringstream ss;
-                        serialize_r<std::ostringstream>(p_rpc->r_format, val,ss);
-                        serialize_out_args<std::ostringstream>(p_rpc->in_args_format, vec,ss);
-                        p_rpc->out_args =  ltrim(ss.str());
+                        //the tokens are views on the payload, decoded before the payload is reused
+                        SCRATCH_STORAGE std::vector<std::string_view> in_args;
+                        split(msg.getValue(), in_args);
+                        deserialize_in_args(p_rpc->in_args_format, in_args, vec.data());
+                    }
+                    else if(!deserialize_in_args(p_rpc->in_args_format, msg.getValue(), vec.data())){
+                        busy(msg);
+                        return;
+                    }
+                    if constexpr (std::is_same<R,void>::value)//constexpr is required here
+                    {
+                        callProcWithArgs(func_address, vec.data(), std::make_index_sequence<nargs>{});
+                        //the input arguments have been decoded: the payload is reused for the output ones
+                        auto& out_args = msg.getValue();//std::string or Payload
+                        out_args.clear();
+                        serialize_out_args(p_rpc->in_args_format, vec.data(), out_args);
                     }
                     else
                     {
-                        std::vector<unsigned char> ss;
-                        serialize_r<std::vector<unsigned char>>(p_rpc->r_format, val,ss);
-                        serialize_out_args<std::vector<unsigned char>>(p_rpc->in_args_format, vec,ss);
-                        p_rpc->out_args = ss;
+                        auto returned_value = callFuncWithArgs(func_address, vec.data(), std::make_index_sequence<nargs>{});
+                        auto val = AnyArg(returned_value);
+                        auto& out_args = msg.getValue();
+                        out_args.clear();
+                        serialize_r(p_rpc->r_format, val, out_args);
+                        serialize_out_args(p_rpc->in_args_format, vec.data(), out_args);
                     }
                 }
             };
             Skeleton<D> rpc;
             rpc.func = f_lambda;
-            rpc.in_args_format = codify_in_args<Args...>();
-            rpc.out_args_format = codify_out_args<Args...>();
+            using Sig = Signature<R, Args...>;
+            rpc.in_args_format = Sig::in_format;
+            rpc.out_args_format = Sig::out_format;
+            rpc.r_format = ParamType<R>::r_id;
+            rpc.id = Sig::id(func_name);
+            rpc.check = Sig::check(func_name);
+            Skeleton<D>* p_rpc = registry.insert(rpc);
+            return p_rpc;
+        }
+
+        //Asynchronous function: void f(Completion<R> done, Args... args), see Completion.
+        //It is called by the server loop thread and has input arguments only: they are valid during the call.
+        template<typename R, typename... Args>
+        Skeleton<D>* connect(const char* func_name, void(*func_address)(Completion<R>, Args...)){
+            static_assert(((!std::is_lvalue_reference_v<Args> || std::is_const_v<std::remove_reference_t<Args>>) && ...),
+                          "Asynchronous functions have input arguments only");
+            static_assert(!HEAP_LESS || sizeof...(Args) <= MAX_ARGS, "The function exceeds MAX_ARGS arguments");
+            auto f_lambda = [this, func_address](Skeleton<D>* p_rpc, MsgHandle handle) {
+                Message<D>& msg = m_pool[handle];
+                const size_t nargs = sizeof...(Args);
+                std::array<AnyArg, nargs> vec;
+                if constexpr (std::is_same<D,std::string>::value){
+                    SCRATCH_STORAGE std::vector<std::string_view> in_args;
+                    split(msg.getValue(), in_args);
+                    deserialize_in_args(p_rpc->in_args_format, in_args, vec.data());
+                }
+                else if(!deserialize_in_args(p_rpc->in_args_format, msg.getValue(), vec.data())){
+                    post_reply(this, handle, RArgTypeId::VOID, nullptr);//truncated arguments: sent back as BUSY
+                    return;
+                }
+                callAsyncWithArgs(func_address, Completion<R>(this, &RpcServer::post_reply, handle), vec.data(),
+                                  std::make_index_sequence<nargs>{});
+            };
+            Skeleton<D> rpc;
+            rpc.async_func = f_lambda;
+            using Sig = Signature<R, Args...>;
+            rpc.in_args_format = Sig::in_format;
+            rpc.out_args_format = Sig::out_format;
             rpc.r_format = ParamType<R>::r_id;
-            std::string sargs = stringify<Args...>();
-            rpc.id = std::string(ParamType<R>::name) + " " + func_name + " " + sargs;
+            rpc.id = Sig::id(func_name);
+            rpc.check = Sig::check(func_name);
             Skeleton<D>* p_rpc = registry.insert(rpc);
             return p_rpc;
         }
 
-        [[maybe_unused]] void disconnect( Skeleton<D>* rpc){
+        //Returns false, leaving the function connected, while the workers run its calls:
+        //retry when doLoop has collected their replies.
+        [[maybe_unused]] bool disconnect( Skeleton<D>* rpc){
+#if SERVER_WORKERS > 0
+            if(rpc != nullptr && rpc->jobs > 0)
+                return false;
+#endif
+            for(auto& method: link_methods){
+                if(method.rpc == rpc)
+                    method.rpc = nullptr;//resolved again by prototype if re-connected
+            }
             registry.remove(rpc);
+            return true;
         }
 
         void initLoop(){
@@ -102,65 +152,368 @@ namespace rpc
             m_init_deserializer = true;
         }
 
+        //Flow control window: the calls accepted in flight (0: no flow control), FLOW_CONTROL_WINDOW by default.
+        //The clients are advertised the new window by their next bind replies (FLOW_CONTROL_WINDOW > 0 only):
+        //the links already bound keep the previous one until they bind again.
+        [[maybe_unused]] void setWindow(uint32_t window){
+            m_window = window;
+        }
+
+        [[maybe_unused]] [[nodiscard]] uint32_t window() const {
+            return m_window;
+        }
+
+
+        //Readiness-driven loop: waits until the link has data to read, a reply is ready or timeout_ms expires.
+        //Returns true when doLoop has work to do.
+        //The replies of the workers and the asynchronous replies posted by other threads wake it through the link
+        //wake hook. Without it they are sent by the doLoop following the end of the wait.
+        [[maybe_unused]] bool wait(uint32_t timeout_ms){
+            if(!tx_msg_buffer.empty() || !m_streamer.tx_empty() || async_replies_ready())
+                return true;
+#if SERVER_WORKERS > 0
+            if(!Comm<T,C>::wakeable() && m_workers.in_flight() > 0)
+                return true;//the workers cannot wake the link wait: their replies are polled by doLoop
+#endif
+            return m_com->wait(timeout_ms);
+        }
 
         void doLoop(){
+#if EVENT_DRIVEN_LOOP
+            //receives the messages ready on the link
+            while(true){
+#else
             TimeOut_t rx_msg_tout;
-            static Message<D> tx_msg;
-            static Message<D> rx_msg;
 
             rx_msg_tout.preset(SERVER_LOOP_TOUT_MS);
             rx_msg_tout.start();
             while(!rx_msg_tout.expired()){
+#endif
                 if(m_init_deserializer)
                 {
-                    m_deserializer.init(&rx_msg);
+                    if((m_rx_handle = m_pool.acquire()) == NO_MSG)
+                        break;//pool exhausted: receive when the pending messages have been sent
+                    m_deserializer.init(&m_pool[m_rx_handle]);
                     m_init_deserializer = false;
                 }
                 if(m_deserializer.receive()) {
-                    rx_msg_buffer.push(rx_msg);
+                    rx_msg_buffer.push(m_rx_handle);
                     m_init_deserializer = true;
                 }
+#if EVENT_DRIVEN_LOOP
+                else if(m_streamer.rx_size() == 0)
+                    break;//nothing more ready: a partial message is completed by the next loops
+#endif
             }
 
             while(!rx_msg_buffer.empty()){
-                Message<D> msg = rx_msg_buffer.front();
-                Skeleton<D>* rpc = registry.get(msg.getName());
-                if(rpc!= nullptr) {
-                    rpc->unmarshall(msg);
-                    rpc->dispatch();
-                    msg = rpc->marshall();
-                    tx_msg_buffer.push(msg);
-                }
+                MsgHandle handle = rx_msg_buffer.front();
                 rx_msg_buffer.pop();
+                dispatch(handle);
+            }
+
+#if SERVER_WORKERS > 0
+            //The replies are queued as they complete: the client matches them by invokation id
+            Skeleton<D>* done_rpc;
+            MsgHandle done;
+            while(m_workers.completed(done_rpc, done)){
+                done_rpc->jobs--;
+                if(m_pool[done].overflow())
+                    m_pool.release(done);
+                else
+                    tx_msg_buffer.push(done);
+            }
+#endif
+
+            //The asynchronous replies in completion order
+            if(m_async_in_flight > 0){
+                lock_async();
+                while(!m_async_done.empty()){
+                    MsgHandle done = m_async_done.front();
+                    m_async_done.pop();
+                    m_async_in_flight--;
+                    if(m_pool[done].overflow())
+                        m_pool.release(done);
+                    else
+                        tx_msg_buffer.push(done);
+                }
+                unlock_async();
             }
 
+#if BATCHING
+            if(m_init_serializer)//between two frames
+                coalesce(m_pool, tx_msg_buffer);
+#endif
+
+            m_streamer.cork();//the driver is written when the buffer is full or at the end of the loop
+#if EVENT_DRIVEN_LOOP
+            while(!tx_msg_buffer.empty()){
+#else
             TimeOut_t tx_msg_tout;
             tx_msg_tout.preset(SERVER_LOOP_TOUT_MS);
             tx_msg_tout.start();
             while(!tx_msg_buffer.empty() && !tx_msg_tout.expired()){
+#endif
                 if(m_init_serializer){
-                    tx_msg  = tx_msg_buffer.front();
-                    m_serializer.init(&tx_msg);
+                    m_serializer.init(&m_pool[tx_msg_buffer.front()]);
                     m_init_serializer = false;
                 }
                 if(m_serializer.send()){
+                    m_pool.release(tx_msg_buffer.front());
                     tx_msg_buffer.pop();
                     m_init_serializer = true;
                 }
+#if EVENT_DRIVEN_LOOP
+                else if(m_streamer.tx_full())
+                    break;//link busy: the message is completed by the next loops
+#endif
             }
-            m_streamer.flush();
+            m_streamer.uncork();
         }
 
     private:
-        std::queue<Message<D>> tx_msg_buffer;
-        std::queue<Message<D>> rx_msg_buffer;
+
+        //The request message is dispatched and sent back in place as the reply
+        void dispatch(MsgHandle handle){
+            Message<D>& msg = m_pool[handle];
+            METHOD_ID_T method;
+            if constexpr(std::is_same_v<D,std::string>)
+                msg.getMethod(method);
+            else
+                method = msg.getMethod();
+            if(method == METHOD_ID_BIND) {
+                bind(msg);
+                tx_msg_buffer.push(handle);
+            }
+#if BATCHING
+            else if(method == METHOD_ID_BATCH)
+                unbatch(handle);
+#endif
+            else {
+                Skeleton<D>* rpc = resolve(method);
+                if(rpc == nullptr || msg.overflow())
+                    reject(handle);//unknown method or truncated request
+                else if(m_window > 0 && in_flight() >= m_window)
+                    reject(handle);
+                else if(rpc->isAsync()){
+                    m_async_in_flight++;//the completion owns the message until its reply is posted
+                    rpc->async_func(rpc, handle);
+                }
+#if SERVER_WORKERS > 0
+                else if(m_workers.submit(rpc, handle))//the worker owns the message until the reply is collected
+                    rpc->jobs++;
+                else
+                    reject(handle);
+#else
+                else {
+                    rpc->dispatch(msg);
+                    if(msg.overflow())
+                        m_pool.release(handle);//truncated reply
+                    else
+                        tx_msg_buffer.push(handle);
+                }
+#endif
+            }
+        }
+
+#if BATCHING
+        //The sub-messages are dispatched in order. Their replies are coalesced again by the transmission.
+        void unbatch(MsgHandle handle){
+            const Payload& batch = m_pool[handle].getValue();
+            size_t ix = 0;
+            while(ix < batch.size()){
+                MsgHandle sub = m_pool.acquire();
+                if(sub == NO_MSG){
+                    reject_batch(handle, ix);//pool exhausted: the rest of the batch is rejected
+                    return;
+                }
+                size_t next = batch_extract(batch, ix, m_pool[sub]);
+                if(next == 0){
+                    m_pool.release(sub);
+                    reject_batch(handle, ix);//truncated batch
+                    return;
+                }
+                ix = next;
+                dispatch(sub);
+            }
+            m_pool.release(handle);
+        }
+
+        //The batch message carries back a BUSY reply for each sub-message from ix whose id is whole.
+        void reject_batch(MsgHandle handle, size_t ix){
+            Message<D>& msg = m_pool[handle];
+            const Payload& batch = msg.getValue();
+            Message<D> busy_msg;
+            busy_msg.setMethod(METHOD_ID_BUSY);
+            m_busy_replies.resetValue();
+            while(ix < batch.size()){
+                INVOKATION_ID_T id;
+                bool has_id = false;
+                size_t next = batch_skip(batch, ix, id, has_id);
+                if(has_id){
+                    busy_msg.setId(id);
+                    batch_append(m_busy_replies.getValue(), busy_msg);
+                }
+                if(next == 0)
+                    break;
+                ix = next;
+            }
+            const Payload& replies = m_busy_replies.getValue();
+            msg.resetValue();
+            msg.writeValue(replies.data(), replies.size());
+            if(replies.empty() || m_busy_replies.overflow())
+                m_pool.release(handle);//no whole id, or more replies than a payload holds
+            else
+                tx_msg_buffer.push(handle);
+        }
+#endif
+
+        //Link method entry: the prototype id and check hash bound by the client and its resolved skeleton.
+        struct LinkMethod{
+            PrototypeId prototype{};
+            PrototypeId check{};
+            bool bound = false;
+            Skeleton<D>* rpc = nullptr;
+        };
+
+        //Binds the client method id carried by the id field to the prototype id and check hash carried by the payload.
+        //The reply status replaces them in the same message. A check hash differing from the connected one is
+        //refused: the prototype ids collide.
+        //A method id beyond the link table capacity is refused with a failure status.
+        void bind(Message<D>& msg){
+            INVOKATION_ID_T method = std::numeric_limits<INVOKATION_ID_T>::max();
+            if constexpr(std::is_same_v<D,std::string>)
+                msg.getId(method);
+            else
+                method = msg.getId();
+            Skeleton<D>* rpc = nullptr;
+            if(method < MAX_REGISTRY_SIZE){
+                LinkMethod& entry = link_methods[method];
+                const auto& payload = msg.getValue();
+                //a payload without a whole prototype is answered with a bind failure
+                if constexpr(std::is_same_v<D,std::string>){
+                    const char* end = payload.data() + payload.size();
+                    auto r = std::from_chars(payload.data(), end, entry.prototype);
+                    entry.bound = r.ec == std::errc() && r.ptr != end && *r.ptr == ' '
+                                  && std::from_chars(r.ptr + 1, end, entry.check).ec == std::errc();
+                }
+                else{
+                    size_t n = stream::read(payload.data(), payload.size(), entry.prototype);
+                    entry.bound = n != 0 && stream::read(payload.data() + n, payload.size() - n, entry.check) != 0;
+                }
+                entry.rpc = entry.bound ? find_bound(entry) : nullptr;
+                rpc = entry.rpc;
+            }
+
+            auto& status = msg.getValue();
+            status.clear();
+            if constexpr(std::is_same_v<D,std::string>)
+                status = rpc != nullptr ? "1" : "0";
+            else
+                status.push_back(rpc != nullptr ? 1 : 0);
+            if constexpr(FLOW_CONTROL_WINDOW > 0)
+                stream::write(status, m_window);//advertised window
+        }
+
+        //Requests accepted and not yet replied
+        [[nodiscard]] size_t in_flight() const {
+#if SERVER_WORKERS > 0
+            return m_async_in_flight + m_workers.in_flight();
+#else
+            return m_async_in_flight;
+#endif
+        }
+
+        //Completion::Post: encodes the asynchronous reply in the message, from any thread.
+        //Without value the request is sent back as BUSY.
+        static void post_reply(void* server, MsgHandle handle, RArgTypeId r_format, const AnyArg* value){
+            auto self = static_cast<RpcServer*>(server);
+            Message<D>& msg = self->m_pool[handle];
+            auto& out_args = msg.getValue();
+            out_args.clear();
+            if(value == nullptr)
+                msg.setMethod(METHOD_ID_BUSY);
+            else if(r_format != RArgTypeId::VOID)
+                serialize_r(r_format, *value, out_args);
+            self->lock_async();
+            self->m_async_done.push(handle);
+            self->unlock_async();
+            self->m_com->wake();
+        }
+
+        static void wake_loop(void* server){
+            static_cast<RpcServer*>(server)->m_com->wake();
+        }
+
+        INLINE void lock_async(){
+            while(m_async_lock.test_and_set(std::memory_order_acquire));
+        }
+
+        INLINE void unlock_async(){
+            m_async_lock.clear(std::memory_order_release);
+        }
+
+        bool async_replies_ready(){
+            if(m_async_in_flight == 0)
+                return false;
+            lock_async();
+            bool ready = !m_async_done.empty();
+            unlock_async();
+            return ready;
+        }
+
+        //The request is sent back with the BUSY method and no payload: the client completes the call as rejected.
+        void reject(MsgHandle handle){
+            busy(m_pool[handle]);
+            tx_msg_buffer.push(handle);
+        }
+
+        //Turns the request into a BUSY reply. Also used for the requests whose arguments cannot be decoded.
+        static void busy(Message<D>& msg){
+            msg.setMethod(METHOD_ID_BUSY);
+            msg.getValue().clear();
+        }
+
+        //O(1) access to the skeleton bound to the method id.
+        //Prototypes not yet connected at bind time are resolved on first use.
+        Skeleton<D>* resolve(METHOD_ID_T method){
+            if(method >= link_methods.size())
+                return nullptr;
+            LinkMethod& entry = link_methods[method];
+            if(entry.rpc == nullptr && entry.bound)
+                entry.rpc = find_bound(entry);
+            return entry.rpc;
+        }
+
+        //The skeleton connected with the prototype of the entry, nullptr when its check hash differs.
+        Skeleton<D>* find_bound(const LinkMethod& entry){
+            Skeleton<D>* rpc = registry.find(entry.prototype);
+            return rpc != nullptr && rpc->check == entry.check ? rpc : nullptr;
+        }
+
+        std::array<LinkMethod, MAX_REGISTRY_SIZE> link_methods{};
+        MsgPool<D> m_pool;
+        MsgHandle m_rx_handle = NO_MSG;
+        MsgQueue tx_msg_buffer;
+        MsgQueue rx_msg_buffer;
+        MsgQueue m_async_done;//asynchronous replies posted and not yet queued for transmission
+        std::atomic_flag m_async_lock = ATOMIC_FLAG_INIT;
+        size_t m_async_in_flight = 0;//server loop thread only
+        uint32_t m_window = FLOW_CONTROL_WINDOW;
+#if BATCHING
+        Message<D> m_busy_replies;//BUSY replies of a rejected batch, reused across the batches
+#endif
         bool m_init_deserializer;
         bool m_init_serializer;
         Comm<T,C>* m_com;
-        FunctionsRegistry<Skeleton<D>> registry;
+        Registry<Skeleton<D>> registry;
         Streamer<T, C> m_streamer;
         DataDeserializer<C> m_deserializer;
         DataSerializer<C> m_serializer;
+#if SERVER_WORKERS > 0
+        //Declared last: the workers are joined before the skeletons and the messages they use are destroyed.
+        WorkerPool<D> m_workers{m_pool, &wake_loop, this};
+#endif
     };
 
 }//namespace rpc
@@ -30,19 +30,15 @@ namespace rpc
 
        explicit Streamer(Comm<T,C>* com) :
                 m_com(com),
-                m_packet_size(com->get_packet_size()){
-            m_tx_buffer = new T[STREAMER_BUFFER_SIZE];
-            m_rx_buffer = new T[STREAMER_BUFFER_SIZE];
-        };
-
-        virtual ~Streamer() {
-            delete[] m_tx_buffer;
-            delete[] m_rx_buffer;
-        }
+                m_packet_size(com->get_packet_size()){};
+
+        virtual ~Streamer() = default;
 
         typedef std::make_signed_t<std::size_t> s_size_t;
 
         size_t write(const T items[], size_t size){
+            if(m_corked && size > m_max_size - tx_size())
+                flush();//makes room
             if(!tx_full())//to avoid overflow
             {
                 size_t available_size;
@@ -69,13 +65,37 @@ namespace rpc
             else
                 size = 0;
 
-            flush();
+            if(!m_corked)
+                flush();
 
             return size;
         }
 
+        //Deferred flush: while corked, write() only buffers the items and flushes when the buffer is full.
+        INLINE void cork(){
+            m_corked = true;
+        }
+
+        //Ends the deferred flush and flushes the buffered items.
+        void uncork(){
+            m_corked = false;
+            flush();
+        }
+
         void flush(){
-            if(m_com->is_open() && !tx_empty()){
+            if constexpr(has_writev_impl<C>::value){
+                //both ring segments in one driver transfer
+                if(m_com->is_open() && !tx_empty()){
+                    size_t used_size = tx_size();
+                    size_t first = std::min(used_size, m_max_size - m_tx_out);
+                    size_t n_written = m_com->writev(&m_tx_buffer[m_tx_out], first, m_tx_buffer.data(), used_size - first);
+                    if(n_written > 0){
+                        inc(m_tx_out, n_written);
+                        m_tx_full = false;
+                    }
+                }
+            }
+            else if(m_com->is_open() && !tx_empty()){
                 size_t used_size;
                 size_t n_written;
                 if(tx_full())
@@ -93,7 +113,7 @@ namespace rpc
                             inc(m_tx_out, n_written);
                             m_tx_full = false;
                             used_size -= n_written;
-                            n_written = m_com->write(m_tx_buffer, count);
+                            n_written = m_com->write(m_tx_buffer.data(), count);
                             if(n_written > 0) {
                                 inc(m_tx_out, n_written);
                                 m_tx_full = false;
@@ -167,6 +187,17 @@ namespace rpc
             return size;
         }
 
+        //Returns the readable items without copying them: the first span starts at the read position,
+        //the second one, if any, at the buffer beginning. The items are released by consume_read.
+        size_t peek(const T*& p1, size_t& n1, const T*& p2, size_t& n2){
+            size_t size = rx_size();
+            n1 = std::min(size, m_max_size - m_rx_out);
+            n2 = size - n1;
+            p1 = &m_rx_buffer[m_rx_out];
+            p2 = m_rx_buffer.data();
+            return size;
+        }
+
         size_t consume_read(size_t size){
             if(rx_empty()){
                 return 0;
@@ -241,7 +272,7 @@ namespace rpc
 
         void com_read(){
             size_t count, len;
-            if(!rx_full()){//to avoid overflow
+            if(!rx_full() && m_com->available() > 0){//to avoid overflow
                 if(m_rx_in >= m_rx_out)
                 {
                     len = m_max_size - m_rx_in;
@@ -251,7 +282,7 @@ namespace rpc
                         m_rx_full = (m_rx_in == m_rx_out);//dbg
                         if(count == len){
                             len = m_rx_out;
-                            count = m_com->read(m_rx_buffer, len);
+                            count = m_com->read(m_rx_buffer.data(), len);
                             if(count>0){
                                 inc(m_rx_in,count);
                                 m_rx_full = (m_rx_in == m_rx_out);
@@ -285,19 +316,20 @@ namespace rpc
         }
 
         //tx
-        T* m_tx_buffer;
+        std::array<T, STREAMER_BUFFER_SIZE> m_tx_buffer;
         size_t m_tx_in = 0;
         size_t m_tx_out = 0;
         bool m_tx_full = false;
 
         //rx
-        T* m_rx_buffer;
+        std::array<T, STREAMER_BUFFER_SIZE> m_rx_buffer;
         size_t m_rx_in = 0;
         size_t m_rx_out = 0;
         bool m_rx_full = false;
 
         //common
         const size_t m_max_size = STREAMER_BUFFER_SIZE;
+        bool m_corked = false;
         Comm<T,C>* m_com;
         size_t m_packet_size;
     };
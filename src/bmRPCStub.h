@@ -24,6 +24,98 @@ namespace bm
 {
 namespace rpc
 {
+    /**
+     * Completion
+     * Server side: completion handle of an asynchronous function, connected with the signature
+     * void f(Completion<R> done, Args... args). The client connects the prototype R(*)(Args...).
+     * The function returns immediately and the reply is sent when done.reply() is invoked, from the server loop
+     * thread or another one: the replies are emitted in completion order.
+     * A completion destroyed without reply sends back a BUSY reply: the client call is completed as rejected.
+     */
+
+    template <typename R>
+    class Completion{
+    public:
+
+        //Encodes the reply (the message is owned by the completion) and queues it for the server loop.
+        using Post = void(*)(void* server, MsgHandle handle, RArgTypeId r_format, const AnyArg* value);
+
+        Completion() = default;
+
+        Completion(void* server, Post post, MsgHandle handle):
+                m_server(server),
+                m_post(post),
+                m_handle(handle)
+        {};
+
+        Completion(const Completion&) = delete;
+        Completion& operator=(const Completion&) = delete;
+
+        Completion(Completion&& other) noexcept:
+                m_server(other.m_server),
+                m_post(other.m_post),
+                m_handle(other.m_handle){
+            other.m_post = nullptr;
+        }
+
+        Completion& operator=(Completion&& other) noexcept{
+            if(this != &other){
+                abandon();
+                m_server = other.m_server;
+                m_post = other.m_post;
+                m_handle = other.m_handle;
+                other.m_post = nullptr;
+            }
+            return *this;
+        }
+
+        ~Completion(){
+            abandon();
+        }
+
+        //The value is converted to R: it is encoded with the format of R.
+        template <typename U = R>
+        void reply(std::enable_if_t<!std::is_void_v<U>, U> value){
+            if(m_post != nullptr){
+                AnyArg r(value);
+                m_post(m_server, m_handle, ParamType<R>::r_id, &r);
+                m_post = nullptr;
+            }
+        }
+
+        template <typename U = R, typename = std::enable_if_t<std::is_void_v<U>>>
+        void reply(){
+            if(m_post != nullptr){
+                AnyArg r;
+                m_post(m_server, m_handle, RArgTypeId::VOID, &r);
+                m_post = nullptr;
+            }
+        }
+
+        //True until the reply has been sent.
+        [[nodiscard]] bool pending() const {
+            return m_post != nullptr;
+        }
+
+    private:
+        void abandon(){
+            if(m_post != nullptr){
+                m_post(m_server, m_handle, RArgTypeId::VOID, nullptr);
+                m_post = nullptr;
+            }
+        }
+
+        void* m_server = nullptr;
+        Post m_post = nullptr;
+        MsgHandle m_handle = NO_MSG;
+    };
+
+    template <typename T>
+    struct is_completion : std::false_type {};
+
+    template <typename R>
+    struct is_completion<Completion<R>> : std::true_type {};
+
     /**
      * Skeleton
      * Server side
@@ -33,48 +125,44 @@ namespace rpc
     class Skeleton{
     public:
 
-        Skeleton():r_format(RArgTypeId::VOID),invocation_id(0){};
+        Skeleton():r_format(RArgTypeId::VOID){};
 
-        void dispatch(){
-            invoke(func, this);
+        //Decodes the arguments from the message payload, calls the function and encodes
+        //the return value and the output arguments in place into the same message.
+        //The message id and method id are left untouched: the request becomes the reply.
+        void dispatch(Message<D>& msg){
+            invoke(func, this, msg);
         }
 
-        std::string& getName(){
+        [[nodiscard]] PrototypeId getPrototypeId() const {
             return id;
         }
 
-        void unmarshall(Message<D>& msg){
-            id = msg.getName();
-            using TData = typename std::conditional<std::is_same_v<D,std::string>, std::string, std::vector<unsigned char>>::type;
-            const TData& data = msg.getValue();
-            unmarshall_args_in(data, in_args);
-            if constexpr(std::is_same_v<D,std::string>)
-                msg.getId(invocation_id);
-            else
-                invocation_id = msg.getId();
+        //Prototypes with the same id are told apart by the check hash and the formats: the ids may collide.
+        [[nodiscard]] bool isSamePrototype(const Skeleton& other) const {
+            return id == other.id && check == other.check && r_format == other.r_format &&
+                   std::equal(in_args_format.begin(), in_args_format.end(), other.in_args_format.begin(), other.in_args_format.end()) &&
+                   std::equal(out_args_format.begin(), out_args_format.end(), other.out_args_format.begin(), other.out_args_format.end());
         }
 
-        Message<D> marshall(){
-            Message<D> msg;
-            msg.setName(id);
-            msg.setValue(out_args);
-            msg.setId(invocation_id);
-            return msg;
+        //Asynchronous function: the reply is sent by its Completion.
+        [[nodiscard]] bool isAsync() const {
+            return (bool)async_func;
         }
 
     protected:
         template <typename T, typename E, typename C>
         friend class RpcServer;
-        std::string id;
-        std::vector<InArgTypeId> in_args_format;
-        std::vector<OutArgTypeId> out_args_format;
+        PrototypeId id{};
+        PrototypeId check{};
+        InFormat in_args_format;
+        OutFormat out_args_format;
         RArgTypeId r_format;
-        using In_TData = typename std::conditional<std::is_same_v<D,std::string>, std::vector<std::string>, std::vector<unsigned char>>::type;
-        In_TData in_args;
-        using Out_TData = typename std::conditional<std::is_same_v<D,std::string>, std::string, std::vector<unsigned char>>::type;
-        Out_TData out_args;
-        uint16_t invocation_id{};
-        std::function<void(Skeleton*)> func;
+        std::function<void(Skeleton*, Message<D>&)> func;
+        std::function<void(Skeleton*, MsgHandle)> async_func;
+#if SERVER_WORKERS > 0
+        size_t jobs = 0;//calls run by the workers and not yet collected, server loop thread only
+#endif
     };
 
 
@@ -83,10 +171,252 @@ namespace rpc
      * Client side
      */
 
+    //Invokation id: the pending table slot in the low bits, the slot generation in the high ones.
+    //The client table is the sequence space of the link: each slot counts its own generations.
+    using InvokationId = INVOKATION_ID_T;
+    constexpr size_t INVOKATION_SLOT_BITS = [](){
+        size_t bits = 0;
+        while(((size_t)1 << bits) < MAX_PENDING_INVOKATIONS) ++bits;
+        return bits;
+    }();
+    constexpr InvokationId INVOKATION_SLOT_MASK = (InvokationId)(((size_t)1 << INVOKATION_SLOT_BITS) - 1);
+    static_assert(INVOKATION_SLOT_BITS + 4 <= sizeof(InvokationId) * CHAR_BIT, "MAX_PENDING_INVOKATIONS leaves too few generation bits in the invokation id");
+
+    /**
+     * CallbackStorage
+     * User callback of a pending invokation, stored in place when it fits CALLBACK_STORAGE_SIZE.
+     * Its type is known only by the completion thunk of the invokation, which takes it back.
+     */
+    class CallbackStorage{
+    public:
+
+        CallbackStorage() = default;
+        CallbackStorage(const CallbackStorage&) = delete;
+        CallbackStorage& operator=(const CallbackStorage&) = delete;
+
+        ~CallbackStorage(){
+            reset();
+        }
+
+        template <typename Cb>
+        void emplace(Cb&& callback){
+            using Callback = std::decay_t<Cb>;
+            reset();
+            if constexpr(fits<Callback>()){
+                m_callback = new(m_storage) Callback(std::forward<Cb>(callback));
+                m_destroy = [](void* p){ static_cast<Callback*>(p)->~Callback(); };
+            }
+            else{
+                static_assert(!HEAP_LESS && sizeof(Callback) > 0, "The callback exceeds CALLBACK_STORAGE_SIZE");
+                m_callback = new Callback(std::forward<Cb>(callback));
+                m_destroy = [](void* p){ delete static_cast<Callback*>(p); };
+            }
+        }
+
+        template <typename Callback>
+        INLINE Callback& get(){
+            return *static_cast<Callback*>(m_callback);
+        }
+
+        void reset(){
+            if(m_destroy != nullptr){
+                m_destroy(m_callback);
+                m_destroy = nullptr;
+                m_callback = nullptr;
+            }
+        }
+
+    private:
+        static constexpr size_t SIZE = std::max((size_t)CALLBACK_STORAGE_SIZE, sizeof(std::function<void(ReturnValue)>));
+
+        template <typename Callback>
+        static constexpr bool fits(){
+            return sizeof(Callback) <= SIZE && alignof(Callback) <= alignof(std::max_align_t)
+                   && std::is_nothrow_move_constructible_v<Callback>;
+        }
+
+        alignas(std::max_align_t) unsigned char m_storage[SIZE];
+        void* m_callback = nullptr;
+        void (*m_destroy)(void*) = nullptr;
+    };
+
+    class InvokationTable;
+
     struct invokation_data{
-        uint16_t id;
-        std::function<void(ReturnValue)> callback;
-        std::vector<void*> out_args_addresses;
+        InvokationId id{};
+        InvokationId generation{};
+        const void* owner = nullptr;//stub waiting for the reply, nullptr when the slot is free
+        bool abandoned = false;//the last invokation of the slot was released without reply
+        uint32_t deadline{};//TimeOut_t tick
+        PoolHandle heap_pos = NO_HANDLE;//position in the deadline heap, NO_HANDLE without deadline
+        //Completes the invokation: decodes the reply (nullptr without reply) by the return type of the call,
+        //releases the slot and invokes the user callback. One thunk per return and callback types.
+        void (*complete)(InvokationTable& table, PoolHandle handle, CallStatus status, void* reply) = nullptr;
+        CallbackStorage callback;
+        OutArgsAddresses out_args_addresses;
+    };
+
+    /**
+     * InvokationTable
+     * Pending invokations of all the stubs of a client in a fixed capacity table.
+     * The reply is matched in O(1) by the slot carried by its invokation id. A late reply, whose slot has
+     * been released or reused since, is rejected by the generation.
+     * The invokations with a deadline are kept in a binary min-heap of slots ordered by deadline.
+     */
+    class InvokationTable{
+    public:
+
+        //Returns NO_HANDLE when the table is full.
+        PoolHandle acquire(const void* owner){
+            PoolHandle handle = m_pool.acquire();
+            if(handle != NO_HANDLE){
+                invokation_data& data = m_pool[handle];
+                data.generation++;
+                data.id = (InvokationId)((data.generation << INVOKATION_SLOT_BITS) | handle);
+                data.owner = owner;
+                data.abandoned = false;
+            }
+            return handle;
+        }
+
+        //Returns NO_HANDLE when no invokation is pending with this id.
+        INLINE PoolHandle find(InvokationId id){
+            PoolHandle handle = id & INVOKATION_SLOT_MASK;
+            if(handle < MAX_PENDING_INVOKATIONS && m_pool[handle].owner != nullptr && m_pool[handle].id == id)
+                return handle;
+            return NO_HANDLE;
+        }
+
+        //Returns NO_HANDLE for a late or unknown reply.
+        INLINE PoolHandle find(const void* owner, InvokationId id){
+            PoolHandle handle = id & INVOKATION_SLOT_MASK;
+            if(handle < MAX_PENDING_INVOKATIONS && m_pool[handle].owner == owner && m_pool[handle].id == id)
+                return handle;
+            return NO_HANDLE;
+        }
+
+        //Accounts a reply without pending invokation. The slot keeps the id of its last invokation until reused:
+        //a second reply to a completed invokation is a duplicate, any other one is late (expired or stale generation).
+        void reject(InvokationId id){
+            PoolHandle handle = id & INVOKATION_SLOT_MASK;
+            if(handle < MAX_PENDING_INVOKATIONS && m_pool[handle].owner == nullptr && m_pool[handle].id == id && !m_pool[handle].abandoned)
+                m_duplicate_replies++;
+            else
+                m_late_replies++;
+        }
+
+        //Invokations waiting for the reply.
+        [[nodiscard]] INLINE size_t size() const {
+            return MAX_PENDING_INVOKATIONS - m_pool.available();
+        }
+
+        [[nodiscard]] INLINE size_t late_replies() const {
+            return m_late_replies;
+        }
+
+        [[nodiscard]] INLINE size_t duplicate_replies() const {
+            return m_duplicate_replies;
+        }
+
+        //Sets the deadline of a pending invokation: O(log n).
+        void set_deadline(PoolHandle handle, uint32_t deadline){
+            m_pool[handle].deadline = deadline;
+            m_heap[m_heap_size] = handle;
+            m_pool[handle].heap_pos = m_heap_size;
+            sift_up(m_heap_size++);
+        }
+
+        //Returns the pending invokation with the earliest deadline when reached at tick, NO_HANDLE otherwise.
+        INLINE PoolHandle expired(uint32_t tick){
+            if(m_heap_size == 0 || !TimeOut_t::reached(m_pool[m_heap[0]].deadline, tick))
+                return NO_HANDLE;
+            return m_heap[0];
+        }
+
+        [[nodiscard]] INLINE bool has_deadlines() const {
+            return m_heap_size > 0;
+        }
+
+        //The callback captures are destroyed here, not when the slot is reused.
+        void release(PoolHandle handle){
+            invokation_data& data = m_pool[handle];
+            if(data.heap_pos != NO_HANDLE)
+                remove_deadline(handle);
+            data.owner = nullptr;
+            data.complete = nullptr;
+            data.callback.reset();
+            data.out_args_addresses.clear();
+            m_pool.release(handle);
+        }
+
+        //Releases an invokation still waiting for the reply (deadline reached or disconnection).
+        void abandon(PoolHandle handle){
+            release(handle);
+            m_pool[handle].abandoned = true;
+        }
+
+        //Releases the invokations of owner still waiting for the reply (disconnection).
+        void release_all(const void* owner){
+            for(PoolHandle handle = 0; handle < MAX_PENDING_INVOKATIONS; ++handle){
+                if(m_pool[handle].owner == owner)
+                    abandon(handle);
+            }
+        }
+
+        INLINE invokation_data& operator[](PoolHandle handle){
+            return m_pool[handle];
+        }
+
+    private:
+        INLINE bool earlier(size_t i, size_t j){
+            return !TimeOut_t::reached(m_pool[m_heap[j]].deadline, m_pool[m_heap[i]].deadline);
+        }
+
+        INLINE void swap(size_t i, size_t j){
+            std::swap(m_heap[i], m_heap[j]);
+            m_pool[m_heap[i]].heap_pos = i;
+            m_pool[m_heap[j]].heap_pos = j;
+        }
+
+        void sift_up(size_t i){
+            while(i > 0 && earlier(i, (i - 1) / 2)){
+                swap(i, (i - 1) / 2);
+                i = (i - 1) / 2;
+            }
+        }
+
+        void sift_down(size_t i){
+            while(true){
+                size_t min = i;
+                size_t left = 2 * i + 1;
+                size_t right = left + 1;
+                if(left < m_heap_size && earlier(left, min))
+                    min = left;
+                if(right < m_heap_size && earlier(right, min))
+                    min = right;
+                if(min == i)
+                    return;
+                swap(i, min);
+                i = min;
+            }
+        }
+
+        void remove_deadline(PoolHandle handle){
+            size_t pos = m_pool[handle].heap_pos;
+            m_pool[handle].heap_pos = NO_HANDLE;
+            if(--m_heap_size == pos)
+                return;
+            m_heap[pos] = m_heap[m_heap_size];
+            m_pool[m_heap[pos]].heap_pos = pos;
+            sift_up(pos);
+            sift_down(m_pool[m_heap[pos]].heap_pos);
+        }
+
+        StaticPool<invokation_data, MAX_PENDING_INVOKATIONS> m_pool;
+        std::array<PoolHandle, MAX_PENDING_INVOKATIONS> m_heap{};
+        size_t m_heap_size = 0;
+        size_t m_late_replies = 0;
+        size_t m_duplicate_replies = 0;
     };
 
     template <typename D>
@@ -95,67 +425,130 @@ namespace rpc
 
         Stub():r_format(RArgTypeId::WRONG),invokation_id(0){};
 
-        Message<D> marshall(){
-            Message<D> msg;
-            msg.setName(id);
-            msg.setValue(in_args);
+        //The payload is encoded in place by the caller.
+        void marshall(Message<D>& msg){
+            msg.setMethod(method_id);
             msg.setId(invokation_id);
-            return msg;
         }
 
-        void unmarshall_and_dispatch(Message<D>& msg){
+        //Binding request: maps the function prototype to the method id once per link.
+        //The check hash lets the server refuse a prototype whose id collides with another one.
+        void marshall_bind(Message<D>& msg){
+            msg.setMethod(METHOD_ID_BIND);
+            auto& value = msg.getValue();
+            value.clear();
+            stream::write(value, id);
+            stream::write(value, check);
+            msg.setId(method_id);
+        }
+
+        //Reads the flow control window advertised by the server after the bind status.
+        //Returns true when the reply advertises it, 0 included (no flow control).
+        bool unmarshall_bind(Message<D>& msg, uint32_t& window){
+            const auto& status = msg.getValue();
+            if constexpr(std::is_same_v<D,std::string>){
+                bound = (!status.empty() && status[0] == '1');
+                if(status.size() <= 2)
+                    return false;
+                stream::read(std::string_view(status).substr(2), window);
+                return true;
+            }
+            else{
+                bound = (!status.empty() && status[0] == 1);
+                return status.size() > 1 && stream::read(status.data() + 1, status.size() - 1, window) > 0;
+            }
+        }
+
+        [[nodiscard]] bool isBound() const {
+            return bound;
+        }
+
+        void unmarshall_and_dispatch(Message<D>& msg, InvokationTable& table){
             //unmarshall
-            id = msg.getName();
-            using TData = typename std::conditional<std::is_same_v<D,std::string>, std::string, std::vector<unsigned char>>::type;
-            const TData& data = msg.getValue();
-            unmarshall_out_args(r_format, data, r_arg, out_args);
             if constexpr(std::is_same_v<D,std::string>)
                 msg.getId(invokation_id);
             else
                 invokation_id = msg.getId();
 
             //dispatch
-            auto pdata = invokation_list.begin();
-            auto pre_pdata = invokation_list.before_begin();
-            for (; pdata != invokation_list.end();) {
-                if (pdata->id == invokation_id) {
-                    break;
+            PoolHandle handle = table.find(this, invokation_id);
+            if(handle == NO_HANDLE){
+                table.reject(invokation_id);//late or duplicate reply
+                return;
+            }
+            invokation_data& data = table[handle];
+            Reply reply{this, &msg, &data.out_args_addresses};
+            data.complete(table, handle, CallStatus::OK, &reply);
+        }
+
+        //Reply handed to the invokation callback, which knows the return type.
+        struct Reply{
+            Stub* stub;
+            Message<D>* msg;
+            OutArgsAddresses* out_args_addresses;
+        };
+
+        //The return value, when R differs from void, precedes the output arguments.
+        //Both are decoded in place from the message payload: the return value by its static type.
+        //A reply too short for them is INVALID.
+        template <typename R>
+        Result<R> unmarshall_result(Message<D>& msg, OutArgsAddresses& out_args_addresses){
+            Result<R> r;
+            size_t ix = 0;
+            if constexpr(std::is_same_v<D,std::string>)
+            {
+                static std::vector<std::string_view> data;//views on the payload
+                split(msg.getValue(), data);
+                if constexpr(!std::is_void_v<R>) {
+                    if(data.empty())
+                        return r;//INVALID
+                    R value{};
+                    stream::read(data[0], value);
+                    r = Result<R>(value);
+                    ix = 1;
                 }
-                else{
-                    pre_pdata = pdata;
-                    ++pdata;
+                if(!deserialize_out_args(out_args_format, data, out_args_addresses, ix))
+                    return Result<R>(CallStatus::INVALID);//missing output arguments
+            }
+            else
+            {
+                Payload& data = msg.getValue();
+                if constexpr(!std::is_void_v<R>) {
+                    R value{};
+                    if((ix = stream::read(data.data(), data.size(), value)) == 0)
+                        return r;//INVALID: truncated return value
+                    r = Result<R>(value);
                 }
+                if(!deserialize_out_args(out_args_format, data, out_args_addresses, ix))
+                    return Result<R>(CallStatus::INVALID);//truncated output arguments
             }
-            ReturnValue r = ReturnValue();
-            if(r_format != RArgTypeId::VOID)
-                r = deserialize_r(r_format,r_arg);
-            deserialize_out_args(out_args_format,out_args,pdata->out_args_addresses);
-            if(pdata->callback)
-                pdata->callback(r);
-            invokation_list.erase_after(pre_pdata);
+            return r;
         }
 
-        std::string& getName(){
+        [[nodiscard]] PrototypeId getPrototypeId() const {
             return id;
         }
 
+        //Prototypes with the same id are told apart by the check hash and the formats: the ids may collide.
+        [[nodiscard]] bool isSamePrototype(const Stub& other) const {
+            return id == other.id && check == other.check && r_format == other.r_format &&
+                   std::equal(in_args_format.begin(), in_args_format.end(), other.in_args_format.begin(), other.in_args_format.end()) &&
+                   std::equal(out_args_format.begin(), out_args_format.end(), other.out_args_format.begin(), other.out_args_format.end());
+        }
+
     protected:
         template <typename T, typename E, typename C>
         friend class RpcClient;
-        std::string id;
-        std::vector<InArgTypeId> in_args_format;
-        std::vector<OutArgTypeId> out_args_format;
+
+        PrototypeId id{};
+        PrototypeId check{};
+        InFormat in_args_format;
+        OutFormat out_args_format;
         RArgTypeId r_format;
-        using In_TData = typename std::conditional<std::is_same_v<D,std::string>, std::string, std::vector<unsigned char>>::type;
-        In_TData in_args;
-        using Out_TData = typename std::conditional<std::is_same_v<D,std::string>, std::vector<std::string>, std::vector<unsigned char>>::type;
-        Out_TData out_args;
-        using TDataItem = typename std::conditional<std::is_same_v<D,std::string>,std::string, std::vector<unsigned char>>::type;
-        TDataItem r_arg;
-        uint16_t invokation_id{};
-        uint16_t invokations = 0;
+        InvokationId invokation_id{};
+        METHOD_ID_T method_id{};//bound by the connect handshake
+        bool bound = false;//set when the server has resolved the method id
         int n_handles = 0;
-        std::forward_list<struct invokation_data> invokation_list;
     };
 
 
@@ -19,16 +19,35 @@
 
 #include "bmRPC.h"
 #include <thread>// required for sleep_for
+#include <sstream>
 #include "bmRPCTest.h"
 
 using namespace std;
 using namespace bm;
 using namespace rpc;
 
+//Hexadecimal text of a value. The server functions run on the workers with SERVER_WORKERS > 0:
+//they never change the cout format flags, shared with the client callbacks.
+template<typename V>
+static string to_hex(V value){
+    std::ostringstream s;
+    s << std::hex << +value;
+    return s.str();
+}
+
+#ifdef TEST_SPSC_TRANSPORT
+    using TestLink = SpscChannel<DataItem>;
+    using TestServerCom = SpscServerCom<DataItem>;
+    using TestClientCom = SpscClientCom<DataItem>;
+#else
+    using TestLink = SharedBuffer<DataItem>;
+    using TestServerCom = ServerCom<DataItem>;
+    using TestClientCom = ClientCom<DataItem>;
+#endif
 
 #if BMRPC_SERVER
     #ifdef LOOP_BACK_TEST
-        static RpcServer<DataItem,Data, ServerCom<DataItem>>* server;
+        static RpcServer<DataItem,Data, TestServerCom>* server;
     #else
         //define your server_com
         static RpcServer<DataItem,Data, EmptyCom<DataItem>>* server;
@@ -37,14 +56,36 @@ using namespace rpc;
 
 #if BMRPC_CLIENT
     #ifdef LOOP_BACK_TEST
-        static RpcClient<DataItem,Data,ClientCom<DataItem>>* client;
+        static RpcClient<DataItem,Data,TestClientCom>* client;
     #else
         //define your client_com
         static RpcClient<DataItem,Data,EmptyCom<DataItem>>* client;
     #endif
 #endif
 
-static int total_passed_test = 0;
+static std::atomic<int> total_passed_test{0};
+
+#ifdef TEST_CALLBACK_ALLOCATIONS
+    //Counts the heap allocations of all the threads while enabled
+    static std::atomic<bool> count_allocations{false};
+    static std::atomic<size_t> allocations{0};
+
+    void* operator new(size_t size){
+        if(count_allocations)
+            allocations++;
+        if(void* p = std::malloc(size ? size : 1))
+            return p;
+        throw std::bad_alloc();
+    }
+
+    void operator delete(void* p) noexcept {
+        std::free(p);
+    }
+
+    void operator delete(void* p, size_t) noexcept {
+        std::free(p);
+    }
+#endif//also counted by f1_srv, on the workers with SERVER_WORKERS > 0
 
 #ifdef  TEST_F0
     #if BMRPC_SERVER
@@ -366,8 +407,7 @@ static int total_passed_test = 0;
                 cout << "f4_srv: " << d << " " << s << endl;
                 cout << "f4_srv blob: " << endl;
                 for(auto a: v)
-                    cout << std::hex << +a << " ";
-                cout << std::dec;
+                    cout << to_hex(a) << " ";
                 cout << endl;
                 i++;
                 l++;
@@ -385,8 +425,7 @@ static int total_passed_test = 0;
                 cout << "f4_srv: " << d << " " << s << endl;
                 cout << "f4_srv blob: " << endl;
                 for(auto a: v)
-                    cout << std::hex << +a << " ";
-                cout << std::dec;
+                    cout << to_hex(a) << " ";
                 cout << endl;
                 return (float)(i+l+ll+f+d+k);
             }
@@ -397,8 +436,7 @@ static int total_passed_test = 0;
                     cout << "f4_srv: " << f << " " << s << endl;
                     cout << "f4_srv blob: " << endl;
                     for(auto a: v)
-                        cout << std::hex << +a << " ";
-                    cout << std::dec;
+                        cout << to_hex(a) << " ";
                     cout << endl;
                     i++;
                     l++;
@@ -413,8 +451,7 @@ static int total_passed_test = 0;
                     cout << "f4_srv: " << f << " " << s << endl;
                     cout << "f4_srv blob: " << endl;
                     for(auto a: v)
-                        cout << std::hex << +a << " ";
-                    cout << std::dec;
+                        cout << to_hex(a) << " ";
                     cout << endl;
                     return (float)(i+l+f+k);
                 }
@@ -752,11 +789,10 @@ static int total_passed_test = 0;
     #if BMRPC_SERVER
         #if P64
             double f7_srv(unsigned char c, bool b, unsigned short s, unsigned int i, unsigned long l, unsigned long long ll, float f, double d){
-                cout << "f7_srv: " << std::hex << +c << " " << std::hex << +b << endl;
-                cout << "f7_srv: " << std::hex << +s << " " << std::hex << i << endl;
-                cout << "f7_srv: " << std::hex << l << " " << std::hex << ll << endl;
+                cout << "f7_srv: " << to_hex(c) << " " << to_hex(b) << endl;
+                cout << "f7_srv: " << to_hex(s) << " " << to_hex(i) << endl;
+                cout << "f7_srv: " << to_hex(l) << " " << to_hex(ll) << endl;
                 cout << "f7_srv: " << f << " " << d << endl;
-                cout << std::dec;
                 int j = 0;
                 if(c == F7_c) j++;
                 if(b == F7_b) j++;
@@ -771,10 +807,9 @@ static int total_passed_test = 0;
             double (*f7)(unsigned char c, bool b, unsigned short s, unsigned int i, unsigned long l, unsigned long long ll, float f, double d) = f7_srv;
         #else
             float f7_srv(unsigned char c, bool b, unsigned short s, unsigned int i, unsigned long l, float f){
-                    cout << "f7_srv: " << std::hex << +c << " " << std::hex << +b << endl;
-                    cout << "f7_srv: " << std::hex << +s << " " << std::hex << i << endl;
-                    cout << "f7_srv: " << std::hex << l << " " << std::hex << f << endl;
-                    cout << std::dec;
+                    cout << "f7_srv: " << to_hex(c) << " " << to_hex(b) << endl;
+                    cout << "f7_srv: " << to_hex(s) << " " << to_hex(i) << endl;
+                    cout << "f7_srv: " << to_hex(l) << " " << to_hex(f) << endl;
                     int j = 0;
                     if(c == F7_c) j++;
                     if(b == F7_b) j++;
@@ -931,6 +966,368 @@ static int total_passed_test = 0;
     #endif
 #endif//TEST_F9
 
+#ifdef TEST_F10
+    #define F10_V_SIZE 16
+    #define F10_I_SIZE 9
+    const vector<short> f10_s_expected = {1, -2, 300, -4000, 32767};
+    #if BMRPC_SERVER
+        float f10_srv(const vector<float>& v, vector<short>& s, vector<int>& i, array_view<short> w){
+            cout << "f10_srv before: " << v.size() << " " << s.size() << " " << i.size() << endl;
+            float sum = 0;
+            for(auto x: v)
+                sum += x;
+            for(auto x: w)
+                sum += x;
+            s = f10_s_expected;
+            i.resize(F10_I_SIZE);
+            for(int k = 0; k < F10_I_SIZE; ++k)
+                i[k] = k * 100000 - 7;
+            cout << "f10_srv after: " << sum << " " << s.size() << " " << i.size() << endl;
+            return sum;
+        }
+        float (*f10)(const vector<float>& v, vector<short>& s, vector<int>& i, array_view<short> w) = f10_srv;
+        Skeleton<Data>* pf10rpc;
+        void test_f10_srv(){
+            pf10rpc = server->CONNECT(f10);
+        }
+        void end_test_f10_srv() {
+            server->disconnect(pf10rpc);
+        }
+    #endif
+
+    #if BMRPC_CLIENT
+        #if BMRPC_SERVER == false
+            [[maybe_unused]]  float (*f10)(const vector<float>& v, vector<short>& s, vector<int>& i, array_view<short> w);
+        #endif
+        RpcHandle<Stub<Data>>* pf10h;
+        void init_test_f10_cln() {
+            static RpcHandle<Stub<Data>> f10h = client->connect("f10", f10);
+            pf10h = &f10h;
+        }
+        void test_f10_cln(){
+            static vector<float> v;
+            static vector<short> s = {5, 6, 7};
+            static vector<int> i = {8};
+            static const vector<short> w = {-1000, 2000, -3, 4, 5, -6};
+            float sum = 0;
+            for(auto x: w)
+                sum += x;
+            v.resize(F10_V_SIZE);
+            for(int k = 0; k < F10_V_SIZE; ++k){
+                v[k] = (float)k * 0.5f - 3.25f;
+                sum += v[k];
+            }
+            client->ASYNC_RPC_WITH_CB(f10, *pf10h,[&, sum]( ReturnValue r){
+                if(r.valid())
+                    cout << "f10_cln RV: " << r.get_value<float>() << endl;
+                else
+                    cout << "f10_cln: invalid RPC return type" << endl;
+                bool i_ok = (i.size() == F10_I_SIZE);
+                for(int k = 0; i_ok && k < F10_I_SIZE; ++k)
+                    i_ok = (i[k] == k * 100000 - 7);
+                cout << "f10_cln: " << s.size() << " " << i.size() << endl;
+                if(r.get_value<float>() == sum && s == f10_s_expected && i_ok) {
+                    cout << "Test f10_cln: PASSED!" << endl;
+                    total_passed_test++;
+                }
+                else
+                    cout << "Test f10_cln: FAILED!" << endl;
+            }, v, s, i, array_view<short>(w));
+        }
+        void end_test_f10_cln() {
+            client->disconnect(*pf10h);
+        }
+    #endif
+#endif//TEST_F10
+
+#ifdef TEST_F11
+    #if BMRPC_SERVER
+        //The completions are kept and replied in reverse order by the test loop
+        static std::vector<std::pair<Completion<int>, int>> f11_pending;
+        void f11(Completion<int> done, int a){
+            f11_pending.emplace_back(std::move(done), a);
+        }
+    #endif
+    #if BMRPC_CLIENT
+        [[maybe_unused]] int (*f11_prototype)(int a);
+    #endif
+#endif//TEST_F11
+
+#ifdef TEST_F12
+    #if BMRPC_SERVER
+        //The int is converted to the float return type by the completion
+        void f12(Completion<float> done, int a){
+            done.reply(a);
+        }
+    #endif
+    #if BMRPC_CLIENT
+        [[maybe_unused]] float (*f12_prototype)(int a);
+    #endif
+#endif//TEST_F12
+
+#ifdef TEST_FLOW_CONTROL
+    #if BMRPC_SERVER
+        //The calls stay in flight until the test loop completes them
+        static std::vector<std::pair<Completion<int>, int>> f15_pending;
+        void f15(Completion<int> done, int a){
+            f15_pending.emplace_back(std::move(done), a);
+        }
+    #endif
+    #if BMRPC_CLIENT
+        [[maybe_unused]] int (*f15_prototype)(int a);
+    #endif
+#endif//TEST_FLOW_CONTROL
+
+#if defined(TEST_UNKNOWN_METHOD) && BMRPC_CLIENT
+    [[maybe_unused]] int (*f16_prototype)(int a);//not connected by the server
+#endif
+
+#if defined(TEST_COROUTINE) && BMRPC_CLIENT
+    //Sequential calls: each one is sent when the previous reply has resumed the coroutine.
+    template <typename C>
+    static Task test_coroutine_cln(C* cl, RpcHandle<Stub<Data>>& handle, long& beats, int& passed){
+        for(int i = 0; i < COROUTINE_CALLS; ++i){
+            Result<int> r = co_await cl->CALL_RPC(f9, handle, true, beats);
+            if(r.ok() && r.value() == beats)
+                passed++;
+        }
+    }
+#endif//TEST_COROUTINE
+
+#ifdef TEST_SPSC_THREADS
+    INLINE DataItem spsc_threads_item(size_t i){
+        return (DataItem)(i * 7 + (i >> 8));
+    }
+
+    //The client com writes from a producer thread, the server com reads from the test thread sleeping in wait().
+    //The chunks sizes vary so that the items wrap around the ring at every position.
+    void test_spsc_threads(){
+        static SpscChannel<DataItem> channel;
+        SpscServerCom<DataItem> consumer_com(channel);
+        SpscClientCom<DataItem> producer_com(channel);
+        std::thread producer([&producer_com](){
+            DataItem chunk[SPSC_RING_SIZE / 4];
+            size_t i = 0;
+            size_t size = 1;
+            while(i < SPSC_THREADS_SIZE){
+                size = size % (SPSC_RING_SIZE / 4) + 1;
+                size_t n = std::min(size, (size_t)SPSC_THREADS_SIZE - i);
+                for(size_t k = 0; k < n; ++k)
+                    chunk[k] = spsc_threads_item(i + k);
+                size_t sent = 0;
+                while(sent < n){
+                    if(n - sent > 1)//both buffers of the scatter-gather write
+                        sent += producer_com.writev(chunk + sent, (n - sent) / 2, chunk + sent + (n - sent) / 2, n - sent - (n - sent) / 2);
+                    else
+                        sent += producer_com.write(chunk + sent, n - sent);
+                    if(sent < n)
+                        std::this_thread::yield();//ring full
+                }
+                i += n;
+            }
+        });
+        DataItem buffer[SPSC_RING_SIZE];
+        size_t received = 0;
+        size_t mismatches = 0;
+        int idle = 0;
+        while(received < SPSC_THREADS_SIZE && idle < 100){
+            if(!consumer_com.wait(10)){
+                idle++;
+                continue;
+            }
+            size_t n = consumer_com.read(buffer, sizeof(buffer) / sizeof(DataItem));
+            for(size_t k = 0; k < n; ++k){
+                if(buffer[k] != spsc_threads_item(received + k))
+                    mismatches++;
+            }
+            received += n;
+        }
+        producer.join();
+        cout << "spsc_threads: " << received << " " << mismatches << endl;
+        if(received == SPSC_THREADS_SIZE && mismatches == 0 && consumer_com.available() == 0)
+            cout << "Test spsc_threads: PASSED!" << endl;
+        else
+            cout << "Test spsc_threads: FAILED!" << endl;
+    }
+#endif//TEST_SPSC_THREADS
+
+#ifdef TEST_WORKERS
+    //Run by the workers at the same time: no shared state.
+    long f13(long a, long& b){
+        b = a * 2;
+        return a + 1;
+    }
+
+    //Blocks its worker until released: its calls are in flight while the test disconnects it.
+    static std::atomic<bool> f14_started{false};
+    static std::atomic<bool> f14_release{false};
+    int f14(int a){
+        f14_started = true;
+        TimeOutChrono tout;
+        tout.preset(1000);
+        tout.start();
+        while(!f14_release && !tout.expired())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return a;
+    }
+
+    void test_workers(){
+        static SpscChannel<DataItem> channel;
+        SpscServerCom<DataItem> srv_com(channel);
+        SpscClientCom<DataItem> cln_com(channel);
+        RpcServer srv = CREATE_SERVER(SpscServerCom<DataItem>, srv_com);
+        RpcClient cln = CREATE_CLIENT(SpscClientCom<DataItem>, cln_com);
+        srv_com.open();
+        cln_com.open();
+        srv.initLoop();
+        cln.initLoop();
+        Skeleton<Data>* f13rpc = srv.CONNECT(f13);
+        Skeleton<Data>* f14rpc = srv.CONNECT(f14);
+        RpcHandle<Stub<Data>> f13h = cln.CONNECT(f13);
+        RpcHandle<Stub<Data>> f14h = cln.CONNECT(f14);
+
+        //The server loop runs on its own thread, the client one on the test thread.
+        std::atomic<bool> stop{false};
+        std::thread server_loop([&srv, &stop](){
+            while(!stop){
+                srv.wait(5);
+                srv.doLoop();
+            }
+        });
+        static std::vector<long> outs(WORKERS_CALLS);
+        int sent = 0;
+        int passed = 0;
+        int completed = 0;
+        TimeOutChrono tout;
+        tout.preset(5000);
+        tout.start();
+        while(completed < WORKERS_CALLS && !tout.expired()){
+            while(sent < WORKERS_CALLS && cln.ASYNC_RPC_WITH_CB(f13, f13h, [&passed, &completed, sent](Result<long> r) {
+                if(r.ok() && r.value() == sent + 1 && outs[sent] == sent * 2)
+                    passed++;
+                completed++;
+            }, (long)sent, outs[sent]))
+                ++sent;
+            cln.doLoop();
+            cln.wait(1);
+        }
+        stop = true;
+        server_loop.join();
+
+        //While a slow job runs the server loop sleeps in wait(): the worker wakes it when the reply is ready.
+        std::atomic<int> loops{0};
+        stop = false;
+        std::thread slow_loop([&srv, &stop, &loops](){
+            while(!stop){
+                srv.wait(1000);
+                srv.doLoop();
+                loops++;
+            }
+        });
+        bool slow_done = false;
+        cln.ASYNC_RPC_WITH_CB(f14, f14h, [&slow_done](Result<int> r) {
+            slow_done = r.ok() && r.value() == 14;
+        }, 14);
+        tout.preset(500);
+        tout.start();
+        while(!f14_started && !tout.expired()){
+            cln.doLoop();
+            cln.wait(1);
+        }
+        int loops_started = loops;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        int slow_loops = loops - loops_started;
+        f14_release = true;
+        tout.start();
+        while(!slow_done && !tout.expired()){
+            cln.doLoop();
+            cln.wait(1);
+        }
+        stop = true;
+        srv_com.wake();
+        slow_loop.join();
+        f14_started = false;
+        f14_release = false;
+        cout << "workers_wait_cln: " << slow_loops << " " << slow_done << endl;
+        if(slow_loops <= 1 && slow_done)
+            cout << "Test workers_wait_cln: PASSED!" << endl;
+        else
+            cout << "Test workers_wait_cln: FAILED!" << endl;
+
+        //A function is not disconnected while its call runs on a worker
+        bool f14_done = false;
+        cln.ASYNC_RPC_WITH_CB(f14, f14h, [&f14_done](Result<int> r) {
+            f14_done = r.ok() && r.value() == 14;
+        }, 14);
+        tout.preset(1000);
+        tout.start();
+        while(!f14_started && !tout.expired()){
+            cln.doLoop();
+            srv.doLoop();
+        }
+        bool refused = !srv.disconnect(f14rpc);
+        f14_release = true;
+        tout.start();
+        while(!f14_done && !tout.expired()){
+            srv.doLoop();
+            cln.doLoop();
+        }
+        bool accepted = srv.disconnect(f14rpc);
+        cout << "workers_cln: " << sent << " " << completed << " " << passed << " " << refused << " " << f14_done << " " << accepted << endl;
+        if(passed == WORKERS_CALLS && refused && f14_done && accepted)
+            cout << "Test workers_cln: PASSED!" << endl;
+        else
+            cout << "Test workers_cln: FAILED!" << endl;
+        cln.disconnect(f13h);
+        cln.disconnect(f14h);
+        srv.disconnect(f13rpc);
+    }
+#endif//TEST_WORKERS
+
+#ifdef TEST_ENCODING_BENCHMARK
+    //Decodes the arguments of function from payload as the typed server marshaller does.
+    //Returns the decoded size, 0 when the arguments are truncated.
+    template<typename R, typename... Args>
+    size_t decode_benchmark_args(R(*)(Args...), const Payload& payload){
+        static std::tuple<arg_value_t<Args>...> args;
+        const unsigned char* p = payload.data();
+        const unsigned char* end = payload.data() + payload.size();
+        if(!std::apply([&p, end](auto&... arg){ return (decode_arg(p, end, arg) && ... && true); }, args))
+            return 0;
+        return p - payload.data();
+    }
+
+    template<typename F, typename... Args>
+    void encoding_benchmark(const char* name, Args&&... args){
+        OutArgsAddresses addresses;
+        Payload payload;
+        auto start = std::chrono::steady_clock::now();
+        for(int n = 0; n < ENCODING_BENCHMARK_RUNS; ++n){
+            addresses.clear();
+            payload.clear();
+            serialize_args<F>(addresses, payload, std::forward<Args>(args)...);
+        }
+        auto encode_time = std::chrono::steady_clock::now() - start;
+
+        size_t decoded = 0;
+        start = std::chrono::steady_clock::now();
+        for(int n = 0; n < ENCODING_BENCHMARK_RUNS; ++n)
+            decoded += decode_benchmark_args(F(), payload);
+        auto decode_time = std::chrono::steady_clock::now() - start;
+
+        uint16_t id = 1;
+        METHOD_ID_T method = 1;
+        size_t frame = field_size(id) + field_size(method) + field_size(payload.size()) + payload.size();
+        cout << name << ": " << frame << " bytes on wire, encode "
+             << std::chrono::duration_cast<std::chrono::nanoseconds>(encode_time).count() / ENCODING_BENCHMARK_RUNS << " ns, decode "
+             << std::chrono::duration_cast<std::chrono::nanoseconds>(decode_time).count() / ENCODING_BENCHMARK_RUNS << " ns" << endl;
+        if(decoded == payload.size() * ENCODING_BENCHMARK_RUNS)
+            cout << "Test " << name << " decoding: PASSED!" << endl;
+        else
+            cout << "Test " << name << " decoding: FAILED!" << endl;
+    }
+#endif//TEST_ENCODING_BENCHMARK
+
 
 void test() {
 
@@ -1010,21 +1407,53 @@ void test() {
     delete[] mem_1;
     delete[] mem_2;
 
+#elif defined(TEST_ENCODING_BENCHMARK)
+
+    static_assert(BINARY_BASED_PROTOCOL && P64, "The encoding benchmark requires the binary protocol with P64");
+    cout << "Encoding benchmark: " << (compact_encoding ? "varint" : "fixed width") << " encoding" << endl;
+
+    int i = 5;
+    long l = -1200;
+    long long ll = 1LL << 40;
+    float f = 1.5f;
+    double d = 3.14;
+    string str = "hello";
+    vector<unsigned char> v = {1, 2, 3, 4};
+    vector<int> counters = {0, 1, 2, 3, 5, 8, 13, 21, 34, 55, -1, -2, -3, -5, -8, -13};
+    vector<int> samples(64);
+    for(size_t k = 0; k < samples.size(); ++k)
+        samples[k] = (int)(k * 100000) - 7;
+
+    encoding_benchmark<int(*)(int, double, float&)>("f0", 5, 3.14, f);
+    encoding_benchmark<double(*)(char, bool, short, int, long, long long, float, double)>("f3", 'a', true, (short)-3, 100, -1200L, 1LL << 40, 1.5f, 3.14);
+    encoding_benchmark<float(*)(int&, long&, long long&, float&, double&, string&, vector<unsigned char>&)>("f4", i, l, ll, f, d, str, v);
+    encoding_benchmark<int(*)(int, int, int, unsigned int, unsigned short, long long)>("small integers", 1, -1, 42, 7u, (unsigned short)300, 0LL);
+    encoding_benchmark<int(*)(int, int, unsigned int, long long)>("large integers", INT_MAX, INT_MIN, UINT_MAX, LLONG_MIN);
+    encoding_benchmark<int(*)(const vector<int>&, const vector<int>&)>("int arrays", counters, samples);
+
 #else
 
+#ifdef TEST_SPSC_THREADS
+    test_spsc_threads();
+#endif
+
+#ifdef TEST_WORKERS
+    test_workers();
+#endif
+
     /****
     * Server
     */
 #ifdef LOOP_BACK_TEST
     //Server side
-    SharedBuffer<DataItem> shared_buffer = SharedBuffer<DataItem>();
+    TestLink shared_buffer = TestLink();
 #endif
 
 #if BMRPC_SERVER
 #ifdef LOOP_BACK_TEST
-    ServerCom<DataItem> server_com = ServerCom(shared_buffer);
+    TestServerCom server_com = TestServerCom(shared_buffer);
     //RpcServer server = RpcServer<DataItem,Data, ServerCom<DataItem>>(&server_com);
-    RpcServer my_server = CREATE_SERVER(ServerCom<DataItem>, server_com);
+    RpcServer my_server = CREATE_SERVER(TestServerCom, server_com);
 #else
     //define your server_com
             EmptyCom<DataItem> server_com = EmptyCom<DataItem>();
@@ -1037,9 +1466,9 @@ void test() {
 
 #if BMRPC_CLIENT
 #ifdef LOOP_BACK_TEST
-    ClientCom<DataItem> client_com = ClientCom(shared_buffer);
+    TestClientCom client_com = TestClientCom(shared_buffer);
     //#define CREATE_CLIENT(com_class, com_object) RpcClient<DataItem,Data, com_class>(&(com_object))
-    RpcClient my_client = CREATE_CLIENT(ClientCom<DataItem>, client_com);
+    RpcClient my_client = CREATE_CLIENT(TestClientCom, client_com);
 #else
     //define your client_com
             EmptyCom<DataItem> client_com = EmptyCom<DataItem>();
@@ -1086,6 +1515,10 @@ void test() {
 #ifdef TEST_F8
     test_f8_srv();
 #endif
+
+#ifdef TEST_F10
+    test_f10_srv();
+#endif
 #endif
 
 
@@ -1126,6 +1559,10 @@ void test() {
     init_test_f8_cln();
 #endif
 
+#ifdef TEST_F10
+    init_test_f10_cln();
+#endif
+
     for(int i = 0; i < TEST_MULTIPLE; ++i)
     {
 #ifdef TEST_F0
@@ -1163,6 +1600,10 @@ void test() {
 #ifdef TEST_F8
         test_f8_cln();
 #endif
+
+#ifdef TEST_F10
+        test_f10_cln();
+#endif
     }
 #endif//BMRPC_CLIENT
 
@@ -1196,7 +1637,10 @@ void test() {
     RpcHandle<Stub<Data>> f9h_0 = client->connect("f9", f9);
     RpcHandle<Stub<Data>> f9h_1 = client->connect("f9", f9);
     RpcHandle<Stub<Data>> f9h_2 = client->connect("f9", f9);
-    int f9_invokations = 0;
+    //Each handle issues the same number of calls: the replies of the handles may complete in any order.
+    int f9_invokations_0 = 0;
+    int f9_invokations_1 = 0;
+    int f9_invokations_2 = 0;
 #endif
 #if BMRPC_SERVER
     Skeleton<Data>* f9rpc = server->CONNECT(f9);
@@ -1208,8 +1652,8 @@ void test() {
 #ifdef TEST_F9
 #if BMRPC_CLIENT
 
-        if(f9_invokations < MAX_F8_INVOKATIONS) {
-            if (enable_client_beats_0) {
+        {
+            if (enable_client_beats_0 && f9_invokations_0 < MAX_F8_INVOKATIONS / 3) {
                 bool was_called = client->ASYNC_RPC_WITH_CB(f9, f9h_0, [&](ReturnValue r) {
                     if (r.valid())
                         cout << "f9_cln RV: " << r.get_value<int>() << " " << client_beats_0 << endl;
@@ -1223,11 +1667,11 @@ void test() {
                 }, true, client_beats_0);
                 if(was_called) {
                     enable_client_beats_0 = false;
-                    ++f9_invokations;
+                    ++f9_invokations_0;
                 }
             }
 
-            if (enable_client_beats_1) {
+            if (enable_client_beats_1 && f9_invokations_1 < MAX_F8_INVOKATIONS / 3) {
                 bool was_called = client->ASYNC_RPC_WITH_CB(f9, f9h_1, [&](ReturnValue r) {
                     if (r.valid())
                         cout << "f9_cln RV: " << r.get_value<int>() << " " << client_beats_1 << endl;
@@ -1241,17 +1685,18 @@ void test() {
                 }, true, client_beats_1);
                 if(was_called) {
                     enable_client_beats_1 = false;
-                    ++f9_invokations;
+                    ++f9_invokations_1;
                 }
             }
 
-            if (enable_client_beats_2) {
-                bool was_called = client->ASYNC_RPC_WITH_CB(f9, f9h_2, [&](ReturnValue r) {
-                    if (r.valid())
-                        cout << "f9_cln RV: " << r.get_value<int>() << " " << client_beats_2 << endl;
+            if (enable_client_beats_2 && f9_invokations_2 < MAX_F8_INVOKATIONS / 3) {
+                //typed callback
+                bool was_called = client->ASYNC_RPC_WITH_CB(f9, f9h_2, [&](Result<int> r) {
+                    if (r.ok())
+                        cout << "f9_cln RV: " << r.value() << " " << client_beats_2 << endl;
                     else
                         cout << "f9_cln: invalid RPC return type" << endl;
-                    if (r.get_value<int>() == client_beats_2)
+                    if (r.ok() && r.value() == client_beats_2)
                         cout << "Test f9_cln: PASSED!" << endl;
                     else
                         cout << "Test f9_cln: FAILED!" << endl;
@@ -1259,7 +1704,7 @@ void test() {
                 }, true, client_beats_2);
                 if(was_called) {
                     enable_client_beats_2 = false;
-                    ++f9_invokations;
+                    ++f9_invokations_2;
                 }
             }
         }
@@ -1302,6 +1747,371 @@ void test() {
         cout << endl << "HANDLES TESTS: FAILED!" << endl;
     cout << "TOTAL TESTS: " << client_beats_0 << endl;
 
+#if defined(TEST_TIMEOUT) && BMRPC_SERVER
+    //Only the client loop runs until the call expires: then the late reply must be dropped.
+    int timeout_calls = 0;
+    bool timeout_status = false;
+    long timeout_beats = 0;
+    bool was_called = client->ASYNC_RPC_WITH_TIMEOUT(f9, f9h_0, TEST_TIMEOUT_MS, [&](ReturnValue r) {
+        timeout_calls++;
+        timeout_status = r.timed_out() && !r.valid();
+    }, true, timeout_beats);
+    tout.preset(TEST_TIMEOUT_MS * 4);
+    tout.start();
+    while(!tout.expired()){
+        my_client.doLoop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    tout.start();
+    while(!tout.expired()){
+        my_server.doLoop();
+        my_client.doLoop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    cout << "timeout_cln: " << timeout_calls << " " << timeout_status << " " << timeout_beats << " " << client->late_replies() << endl;
+    if(was_called && timeout_calls == 1 && timeout_status && timeout_beats == 0 && client->late_replies() == 1)
+        cout << "Test timeout_cln: PASSED!" << endl;
+    else
+        cout << "Test timeout_cln: FAILED!" << endl;
+#endif
+
+#if defined(TEST_CALLBACK_ALLOCATIONS) && BMRPC_SERVER
+    //The std::function is stored as it is in the invokation slot. The first round trip grows the pooled messages.
+    long allocation_beats = 0;
+    int allocation_replies = 0;
+    std::function<void(ReturnValue)> allocation_cb = [&allocation_replies](ReturnValue r) {
+        allocation_replies += r.valid();
+    };
+    size_t round_allocations[2] = {};
+    for(int round = 0; round < 2; ++round){
+        allocations = 0;
+        count_allocations = true;
+        client->ASYNC_RPC_WITH_CB(f9, f9h_0, allocation_cb, true, allocation_beats);
+        tout.preset(500);
+        tout.start();
+        while(!tout.expired() && allocation_replies == round){
+            my_server.doLoop();
+            my_client.doLoop();
+        }
+        count_allocations = false;
+        round_allocations[round] = allocations;
+    }
+    cout << "callback_allocations_cln: " << allocation_replies << " " << round_allocations[0] << " " << round_allocations[1] << endl;
+    if(allocation_replies == 2 && round_allocations[1] == 0)
+        cout << "Test callback_allocations_cln: PASSED!" << endl;
+    else
+        cout << "Test callback_allocations_cln: FAILED!" << endl;
+#endif
+
+#if defined(TEST_F11) && BMRPC_SERVER
+    //The replies are emitted in completion order: the last call is completed first.
+    Skeleton<Data>* f11rpc = server->CONNECT(f11);
+    RpcHandle<Stub<Data>> f11h = client->connect("f11", f11_prototype);
+    std::vector<int> f11_results;
+    for(int i = 1; i <= F11_CALLS; ++i){
+        client->ASYNC_RPC_WITH_CB(f11_prototype, f11h, [&](Result<int> r) {
+            f11_results.push_back(r.value_or(-1));
+        }, i);
+    }
+    tout.preset(500);
+    tout.start();
+    while(!tout.expired() && f11_results.size() < F11_CALLS){
+        if(f11_pending.size() == F11_CALLS){
+            while(!f11_pending.empty()){
+                f11_pending.back().first.reply(f11_pending.back().second * 10);
+                f11_pending.pop_back();
+            }
+        }
+        my_server.doLoop();
+        my_client.doLoop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    cout << "f11_cln:";
+    for(int r : f11_results)
+        cout << " " << r;
+    cout << endl;
+    if(f11_results == std::vector<int>{30, 20, 10})
+        cout << "Test f11_cln: PASSED!" << endl;
+    else
+        cout << "Test f11_cln: FAILED!" << endl;
+    client->disconnect(f11h);
+    server->disconnect(f11rpc);
+#endif
+
+#if defined(TEST_F12) && BMRPC_SERVER
+    Skeleton<Data>* f12rpc = server->CONNECT(f12);
+    RpcHandle<Stub<Data>> f12h = client->connect("f12", f12_prototype);
+    float f12_result = 0;
+    bool f12_done = false;
+    client->ASYNC_RPC_WITH_CB(f12_prototype, f12h, [&](Result<float> r) {
+        f12_result = r.value_or(-1);
+        f12_done = true;
+    }, 7);
+    tout.preset(500);
+    tout.start();
+    while(!tout.expired() && !f12_done){
+        my_server.doLoop();
+        my_client.doLoop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    cout << "f12_cln: " << f12_result << endl;
+    if(f12_result == 7.0f)
+        cout << "Test f12_cln: PASSED!" << endl;
+    else
+        cout << "Test f12_cln: FAILED!" << endl;
+    client->disconnect(f12h);
+    server->disconnect(f12rpc);
+#endif
+
+#if defined(TEST_COROUTINE) && BMRPC_SERVER
+    RpcHandle<Stub<Data>> coroutine_h = client->connect("f9", f9);
+    long coroutine_beats = 0;
+    int coroutine_passed = 0;
+    bool started = test_coroutine_cln(client, coroutine_h, coroutine_beats, coroutine_passed).started();
+    tout.preset(500);
+    tout.start();
+    while(!tout.expired() && coroutine_passed < COROUTINE_CALLS){
+        my_server.doLoop();
+        my_client.doLoop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    cout << "coroutine_cln: " << coroutine_passed << " " << coroutine_beats << endl;
+    if(started && coroutine_passed == COROUTINE_CALLS && coroutine_beats == COROUTINE_CALLS)
+        cout << "Test coroutine_cln: PASSED!" << endl;
+    else
+        cout << "Test coroutine_cln: FAILED!" << endl;
+    client->disconnect(coroutine_h);
+#endif
+
+#if defined(TEST_COLLISION) && BMRPC_SERVER
+    //Different prototypes with the same id are not aliased: the second connect fails.
+    static_assert(Signature<int, bool, long&>::id("f9_162789") == Signature<int, bool, long&>::id("f9_379192"),
+                  "The collision test requires two prototypes with the same id");
+    Skeleton<Data>* collision_rpc = server->connect("f9_162789", f9);
+    Skeleton<Data>* colliding_rpc = server->connect("f9_379192", f9);
+    RpcHandle<Stub<Data>> collision_h = client->connect("f9_162789", f9);
+    RpcHandle<Stub<Data>> colliding_h = client->connect("f9_379192", f9);
+    tout.preset(100);
+    tout.start();
+    while(!tout.expired() && !collision_h.getStub()->isBound()){
+        my_server.doLoop();
+        my_client.doLoop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    cout << "collision_cln: " << (collision_rpc != nullptr) << " " << (colliding_rpc != nullptr) << " "
+         << collision_h.getStub()->isBound() << " " << (colliding_h.getStub() != nullptr) << endl;
+    if(collision_rpc != nullptr && colliding_rpc == nullptr && collision_h.getStub()->isBound() && colliding_h.getStub() == nullptr)
+        cout << "Test collision_cln: PASSED!" << endl;
+    else
+        cout << "Test collision_cln: FAILED!" << endl;
+    client->disconnect(collision_h);
+    //Across the link the check hash tells the prototypes apart: the server refuses the bind and the call.
+    RpcHandle<Stub<Data>> remote_h = client->connect("f9_379192", f9);
+    std::vector<CallStatus> remote_status;
+    long remote_beats = 0;
+    client->ASYNC_RPC_WITH_CB(f9, remote_h, [&remote_status](Result<int> r) {
+        remote_status.push_back(r.status());
+    }, true, remote_beats);
+    tout.start();
+    while(!tout.expired() && remote_status.empty()){
+        my_server.doLoop();
+        my_client.doLoop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    cout << "remote_collision_cln: " << remote_h.getStub()->isBound() << " " << remote_status.size() << " " << remote_beats << endl;
+    if(!remote_h.getStub()->isBound() && remote_status == std::vector<CallStatus>{CallStatus::REJECTED} && remote_beats == 0)
+        cout << "Test remote_collision_cln: PASSED!" << endl;
+    else
+        cout << "Test remote_collision_cln: FAILED!" << endl;
+    client->disconnect(remote_h);
+    server->disconnect(collision_rpc);
+#endif
+
+#if defined(TEST_TRUNCATED_REPLY) && BMRPC_SERVER
+    //The replies are decoded as if received for f9: both are too short for the int return value
+    //and the long output argument.
+    Message<Data> truncated;
+    long truncated_beats = 0;
+    OutArgsAddresses truncated_addresses;
+    truncated_addresses.push_back(&truncated_beats);
+    Result<int> empty_r = f9h_0.getStub()->unmarshall_result<int>(truncated, truncated_addresses);
+    if(is_binary_protocol)
+        truncated.getValue().push_back(0x80);//first byte of a value continued by the missing ones
+    else
+        truncated.getValue().push_back('5');//return value without the output argument
+    Result<int> short_r = f9h_0.getStub()->unmarshall_result<int>(truncated, truncated_addresses);
+    cout << "truncated_reply_cln: " << (int)empty_r.status() << " " << (int)short_r.status() << " " << truncated_beats << endl;
+    if(empty_r.status() == CallStatus::INVALID && short_r.status() == CallStatus::INVALID && truncated_beats == 0)
+        cout << "Test truncated_reply_cln: PASSED!" << endl;
+    else
+        cout << "Test truncated_reply_cln: FAILED!" << endl;
+#endif
+
+#if defined(TEST_BATCH) && BMRPC_SERVER
+    //The calls queued within a loop leave the client as one batch frame. The frame is captured from the link
+    //and sent to the server: whole, then cut within its last call. The cut call is answered BUSY.
+    TestServerCom batch_rx_com = TestServerCom(shared_buffer);
+    TestClientCom batch_tx_com = TestClientCom(shared_buffer);
+    batch_rx_com.open();
+    batch_tx_com.open();
+    Streamer<DataItem, TestServerCom> batch_rx_streamer(&batch_rx_com);
+    Streamer<DataItem, TestClientCom> batch_tx_streamer(&batch_tx_com);
+    DataDeserializer<TestServerCom> batch_rx(batch_rx_streamer);
+    DataSerializer<TestClientCom> batch_tx(batch_tx_streamer);
+    RpcHandle<Stub<Data>>* batch_handles[BATCH_CALLS] = {&f9h_0, &f9h_1, &f9h_2};
+    //Returns the number of calls carried by the frame, 0 when it is not a batch.
+    auto batch_round = [&](size_t cut, std::vector<CallStatus>& status, long (&beats)[BATCH_CALLS]) -> size_t {
+        for(auto& handle: batch_handles)
+            client->ASYNC_RPC_WITH_TIMEOUT(f9, *handle, BATCH_TIMEOUT_MS, [&status](Result<int> r) {
+                status.push_back(r.status());
+            }, true, beats[&handle - batch_handles]);
+        my_client.doLoop();
+        Message<Data> frame;
+        batch_rx.init(&frame);
+        tout.preset(500);
+        tout.start();
+        while(!batch_rx.receive() && !tout.expired());
+        size_t calls = 0;
+        Message<Data> call;
+        for(size_t ix = 0; frame.getMethod() == METHOD_ID_BATCH && ix < frame.getSize(); ++calls){
+            if((ix = batch_extract(frame.getValue(), ix, call)) == 0)
+                return 0;
+        }
+        frame.getValue().resize(frame.getSize() - cut);
+        batch_tx.init(&frame);
+        while(!batch_tx.send() && !tout.expired());
+        while(!tout.expired() && status.size() < BATCH_CALLS){
+            my_server.doLoop();
+            my_client.doLoop();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return calls;
+    };
+    std::vector<CallStatus> batch_status;
+    long batch_beats[BATCH_CALLS] = {};
+    size_t batch_calls = batch_round(0, batch_status, batch_beats);
+    //the last call arguments lose one byte: the server rejects it and runs the others
+    std::vector<CallStatus> cut_status;
+    long cut_beats[BATCH_CALLS] = {};
+    size_t cut_calls = batch_round(1, cut_status, cut_beats);
+    cout << "batch_cln: " << batch_calls << " " << batch_status.size() << " " << cut_calls << " " << cut_status.size() << endl;
+    if(batch_calls == BATCH_CALLS && batch_status == std::vector<CallStatus>(BATCH_CALLS, CallStatus::OK)
+       && batch_beats[0] == 1 && batch_beats[1] == 1 && batch_beats[2] == 1)
+        cout << "Test batch_cln: PASSED!" << endl;
+    else
+        cout << "Test batch_cln: FAILED!" << endl;
+    if(cut_calls == BATCH_CALLS && cut_status == std::vector<CallStatus>{CallStatus::OK, CallStatus::OK, CallStatus::REJECTED}
+       && cut_beats[0] == 1 && cut_beats[1] == 1 && cut_beats[2] == 0)
+        cout << "Test truncated_batch_cln: PASSED!" << endl;
+    else
+        cout << "Test truncated_batch_cln: FAILED!" << endl;
+#endif
+
+#if defined(TEST_FLOW_CONTROL) && BMRPC_SERVER
+    //The calls are sent with the bind request, before the client knows the small window:
+    //the server rejects the one beyond it. Then the client refuses the calls while the window is full.
+    server->setWindow(FLOW_CONTROL_TEST_WINDOW);
+    Skeleton<Data>* f15rpc = server->CONNECT(f15);
+    RpcHandle<Stub<Data>> f15h = client->connect("f15", f15_prototype);
+    std::vector<CallStatus> f15_status;
+    std::vector<int> f15_results;
+    auto f15_cb = [&](Result<int> r) {
+        f15_status.push_back(r.status());
+        if(r.ok())
+            f15_results.push_back(r.value());
+    };
+    int f15_sent = 0;
+    for(int i = 1; i <= FLOW_CONTROL_TEST_WINDOW + 1; ++i)
+        f15_sent += client->ASYNC_RPC_WITH_CB(f15_prototype, f15h, f15_cb, i);
+    tout.preset(500);
+    tout.start();
+    while(!tout.expired() && f15_status.empty()){
+        my_server.doLoop();
+        my_client.doLoop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    bool f15_rejected = f15_status.size() == 1 && f15_status[0] == CallStatus::REJECTED;
+    uint32_t f15_window = client->window();
+    bool f15_refused = !client->ASYNC_RPC_WITH_CB(f15_prototype, f15h, f15_cb, 10);
+    while(!f15_pending.empty()){
+        f15_pending.back().first.reply(f15_pending.back().second * 10);
+        f15_pending.pop_back();
+    }
+    tout.start();
+    while(!tout.expired() && f15_status.size() < FLOW_CONTROL_TEST_WINDOW + 1){
+        my_server.doLoop();
+        my_client.doLoop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    cout << "flow_control_cln: " << f15_sent << " " << f15_rejected << " " << f15_window << " " << f15_refused << " " << f15_results.size() << endl;
+    if(f15_sent == FLOW_CONTROL_TEST_WINDOW + 1 && f15_rejected && f15_window == FLOW_CONTROL_TEST_WINDOW && f15_refused
+       && f15_results == std::vector<int>{20, 10})
+        cout << "Test flow_control_cln: PASSED!" << endl;
+    else
+        cout << "Test flow_control_cln: FAILED!" << endl;
+    //A window of 0 advertised by the next bind lifts the client flow control
+    server->setWindow(0);
+    client->disconnect(f15h);
+    f15h = client->connect("f15", f15_prototype);
+    tout.start();
+    while(!tout.expired() && client->window() != 0){
+        my_server.doLoop();
+        my_client.doLoop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    int f15_unlimited = 0;
+    for(int i = 1; i <= FLOW_CONTROL_TEST_WINDOW + 1; ++i)
+        f15_unlimited += client->ASYNC_RPC_WITH_CB(f15_prototype, f15h, f15_cb, i);
+    tout.start();
+    while(!tout.expired() && f15_pending.size() < FLOW_CONTROL_TEST_WINDOW + 1){
+        my_server.doLoop();
+        my_client.doLoop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    size_t f15_accepted = f15_pending.size();
+    while(!f15_pending.empty()){
+        f15_pending.back().first.reply(f15_pending.back().second);
+        f15_pending.pop_back();
+    }
+    tout.start();
+    while(!tout.expired() && client->in_flight() > 0){
+        my_server.doLoop();
+        my_client.doLoop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    cout << "flow_control_off_cln: " << client->window() << " " << f15_unlimited << " " << f15_accepted << endl;
+    if(client->window() == 0 && f15_unlimited == FLOW_CONTROL_TEST_WINDOW + 1 && f15_accepted == FLOW_CONTROL_TEST_WINDOW + 1
+       && client->in_flight() == 0)
+        cout << "Test flow_control_off_cln: PASSED!" << endl;
+    else
+        cout << "Test flow_control_off_cln: FAILED!" << endl;
+    server->setWindow(FLOW_CONTROL_WINDOW);//the links already bound keep their window until their next bind
+    client->disconnect(f15h);
+    server->disconnect(f15rpc);
+#endif
+
+#if defined(TEST_UNKNOWN_METHOD) && BMRPC_SERVER
+    //The server answers BUSY to the call of a method it has not bound: the call does not stay pending.
+    RpcHandle<Stub<Data>> f16h = client->connect("f16", f16_prototype);
+    std::vector<CallStatus> f16_status;
+    bool f16_sent = client->ASYNC_RPC_WITH_CB(f16_prototype, f16h, [&f16_status](Result<int> r) {
+        f16_status.push_back(r.status());
+    }, 16);
+    tout.preset(500);
+    tout.start();
+    while(!tout.expired() && f16_status.empty()){
+        my_server.doLoop();
+        my_client.doLoop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    cout << "unknown_method_cln: " << f16_sent << " " << f16_status.size() << " " << client->in_flight() << endl;
+    if(f16_sent && f16_status == std::vector<CallStatus>{CallStatus::REJECTED} && client->in_flight() == 0)
+        cout << "Test unknown_method_cln: PASSED!" << endl;
+    else
+        cout << "Test unknown_method_cln: FAILED!" << endl;
+    client->disconnect(f16h);
+#endif
+
 
 #ifdef TEST_F0
     end_test_f0_cln();
@@ -1338,6 +2148,10 @@ void test() {
 #ifdef TEST_F8
     end_test_f8_cln();
 #endif
+
+#ifdef TEST_F10
+    end_test_f10_cln();
+#endif
 #endif
 
 #if BMRPC_SERVER
@@ -1377,6 +2191,10 @@ void test() {
     end_test_f8_srv();
 #endif
 
+#ifdef TEST_F10
+    end_test_f10_srv();
+#endif
+
 #ifdef TEST_F9
 #if BMRPC_CLIENT
     client->disconnect(f9h_0);
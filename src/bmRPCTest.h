@@ -23,6 +23,21 @@
 //Test Cases List
 //STREAMER TEST is in alternative to all the other tests.
 //#define TEST_STREAMER
+//ENCODING BENCHMARK TEST is in alternative to all the other tests (binary protocol with P64).
+//It reports the bytes on wire and the encode/decode times of typical calls: build it with COMPACT_ENCODING
+//true and false to compare the varint and the fixed width encodings.
+//#define TEST_ENCODING_BENCHMARK
+#define ENCODING_BENCHMARK_RUNS 100000
+//SPSC TRANSPORT TEST runs the test cases over the SPSC ring link in place of the SharedBuffer.
+//#define TEST_SPSC_TRANSPORT
+#ifdef TEST_SPSC_TRANSPORT
+#define TEST_SPSC_THREADS // a producer thread streams a sequence to a consumer thread through the SPSC ring
+#define SPSC_THREADS_SIZE (1 << 20)
+#if SERVER_WORKERS > 0 && BMRPC_SERVER && BMRPC_CLIENT
+#define TEST_WORKERS // server loop thread with SERVER_WORKERS workers and client thread over the SPSC ring
+#define WORKERS_CALLS 2000
+#endif
+#endif
 #define TEST_F0 //int f0(int a, double b, float& c)
 #define TEST_F1 //void f1(int a)
 #define TEST_F2 // long f2(int a, double b, double& c)
@@ -32,10 +47,44 @@
 #define TEST_F6 // int f6(int a, float& b, string& c)
 #define TEST_F7 // double f7(unsigned char c, bool b, unsigned short s, unsigned int i, unsigned long l, unsigned long long ll, float f, double d)
 #define TEST_F8 // void f8(int& a, float& b, string& c) //no callback
+#if BINARY_BASED_PROTOCOL
+#define TEST_F10 // float f10(const vector<float>& v, vector<short>& s, vector<int>& i, array_view<short> w)
+#endif
+#ifdef TEST_F10
+#define MAX_MULTIPLE_F 10
+#else
 #define MAX_MULTIPLE_F 9
-#define TEST_MULTIPLE MAX_CLIENT_MSG_BUFFER_SIZE/MAX_MULTIPLE_F
+#endif
+//The client queue holds MAX_CLIENT_MSG_BUFFER_SIZE + 1 messages, the connect handshakes included.
+#define TEST_MULTIPLE (MAX_CLIENT_MSG_BUFFER_SIZE + 1 - MAX_MULTIPLE_F)/MAX_MULTIPLE_F
 #define TEST_F9 // int f8(bool b, long& c)
 #define MAX_F8_INVOKATIONS 300
+#ifdef TEST_F9
+#define TEST_TIMEOUT // f9 call expiring while the server loop is not run
+#define TEST_TIMEOUT_MS 20
+#endif
+#define TEST_F11 // int f11(int a): asynchronous server function replying out of order
+#define F11_CALLS 3
+#define TEST_F12 // float f12(int a): asynchronous server function replying an int
+#if FLOW_CONTROL_WINDOW > 0
+#define TEST_FLOW_CONTROL // int f15(int a): asynchronous calls beyond a small server window
+#define FLOW_CONTROL_TEST_WINDOW 2
+#endif
+#define TEST_UNKNOWN_METHOD // int f16(int a): call of a function the server does not provide
+#if BMRPC_COROUTINES && defined(TEST_F9)
+#define TEST_COROUTINE // f9 calls co_awaited by a coroutine (C++20 builds)
+#define COROUTINE_CALLS 3
+#endif
+#ifdef TEST_F9
+#define TEST_COLLISION // f9 connected under two names colliding on the prototype id
+#define TEST_TRUNCATED_REPLY // f9 replies too short for the return value
+#define TEST_CALLBACK_ALLOCATIONS // f9 round trip with a std::function callback: no heap allocation
+#endif
+#if BATCHING && defined(TEST_F9) && defined(LOOP_BACK_TEST)
+#define TEST_BATCH // f9 calls sent as one batch frame, whole and truncated
+#define BATCH_CALLS 3
+#define BATCH_TIMEOUT_MS 50
+#endif
 
 void test();
 
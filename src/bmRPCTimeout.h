@@ -41,6 +41,16 @@ namespace rpc
         INLINE bool expired(){
             return static_cast<T*>(this)->expired_impl();
         }
+
+        //Free running milliseconds tick used for the call deadlines: it wraps around.
+        INLINE static uint32_t now(){
+            return T::now_impl();
+        }
+
+        //True when the tick deadline has been reached, wrap around safe.
+        INLINE static bool reached(uint32_t deadline, uint32_t tick){
+            return (int32_t)(tick - deadline) >= 0;
+        }
     };
 
 
@@ -64,12 +74,18 @@ namespace rpc
             return false;
         }
 
+        static uint32_t now_impl(){
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch());
+            return (uint32_t)ms.count();
+        }
+
     private:
         std::chrono::high_resolution_clock::time_point m_start;
         long m_tout_preset;
     };
 
-    using TimeOut_t = TimeOut<TimeOutChrono>;
+    //The derived class has to be used: the CRTP base class has no storage for the timer state.
+    using TimeOut_t = TimeOutChrono;
 
 }//namespace rpc
 }//namespace bm
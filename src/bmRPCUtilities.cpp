@@ -22,6 +22,7 @@
 #include <unordered_map>
 #include <vector>
 #include <charconv>     //from_chars and to_chars
+#include <climits> //char_bit for the varints
 #include <algorithm>// for godbolt
 #include <chrono> // for godbolt
 #include "bmRPCUtilities.h"
@@ -30,7 +31,7 @@ namespace bm
 {
 namespace rpc
 {
-    std::string ltrim(const std::string &str) {
+    [[maybe_unused]] std::string ltrim(const std::string &str) {
         std::string s(str);
         s.erase(
                 s.begin(),
@@ -51,18 +52,17 @@ namespace rpc
         return s;
     }
 
-    std::vector<std::string> split(const std::string &str) {
-        std::vector<std::string> tokens;
+    void split(std::string_view str, std::vector<std::string_view>& tokens) {
+        tokens.clear();
 
-        std::string::size_type start = 0;
-        std::string::size_type end;
+        std::string_view::size_type start = 0;
+        std::string_view::size_type end;
 
-        while ((end = str.find(' ', start)) != std::string::npos) {
+        while ((end = str.find(' ', start)) != std::string_view::npos) {
             tokens.push_back(str.substr(start, end - start));
             start = end + 1;
         }
         tokens.push_back(str.substr(start));
-        return tokens;
     }
 
     //String version of split
@@ -35,11 +35,12 @@ namespace rpc
         typedef std::remove_cv_t<std::remove_reference_t<G>> type;
     };
 
-    std::string ltrim(const std::string &str);
+    [[maybe_unused]] std::string ltrim(const std::string &str);
 
     [[maybe_unused]] std::string rtrim(const std::string &str);
 
-    std::vector<std::string> split(const std::string &str);
+    //Space separated tokens of str, the empty ones included, as views on str. tokens keeps its capacity.
+    void split(std::string_view str, std::vector<std::string_view>& tokens);
 
     //String version of split
     [[maybe_unused]] std::vector<std::string> splitST(const std::string& str, const std::string& delims = " ");
@@ -50,6 +51,66 @@ namespace rpc
     //adjust size to the closest, but minor, power of two.
     [[maybe_unused]] size_t adjust_power_2(size_t size);
 
+    /**
+     * Varint
+     * LEB128: 7 bits per byte, least significant group first, the MSB set on all but the last byte.
+     * Signed values are zigzag mapped (0,-1,1,-2... to 0,1,2,3...) so that small magnitudes stay short.
+     */
+
+    constexpr size_t MAX_VARINT_SIZE = (sizeof(uint64_t) * CHAR_BIT + 6) / 7;
+
+    template<typename T>
+    constexpr std::make_unsigned_t<T> zigzag(T value){
+        using U = std::make_unsigned_t<T>;
+        return (U(value) << 1) ^ U(value >> (sizeof(T) * CHAR_BIT - 1));
+    }
+
+    template<typename U>
+    constexpr std::make_signed_t<U> unzigzag(U value){
+        using S = std::make_signed_t<U>;
+        return S(value >> 1) ^ -S(value & 1);
+    }
+
+    template<typename U>
+    constexpr size_t varint_size(U value){
+        size_t n = 1;
+        while(value >= 0x80){
+            value >>= 7;
+            ++n;
+        }
+        return n;
+    }
+
+    //Encodes value at p (room for MAX_VARINT_SIZE bytes). Returns the encoded size.
+    template<typename U>
+    inline size_t encode_varint(unsigned char* p, U value){
+        static_assert(std::is_unsigned_v<U>, "Varints encode unsigned values");
+        size_t n = 0;
+        while(value >= 0x80){
+            p[n++] = (unsigned char)(value | 0x80);
+            value >>= 7;
+        }
+        p[n++] = (unsigned char)value;
+        return n;
+    }
+
+    //Decodes a varint from at most n bytes at p. Returns the decoded size, 0 (and value 0) when truncated.
+    template<typename U>
+    inline size_t decode_varint(const unsigned char* p, size_t n, U& value){
+        static_assert(std::is_unsigned_v<U>, "Varints decode unsigned values");
+        uint64_t v = 0;
+        n = std::min(n, MAX_VARINT_SIZE);
+        for(size_t i = 0; i < n; ++i){
+            v |= uint64_t(p[i] & 0x7F) << (7 * i);
+            if(!(p[i] & 0x80)){
+                value = U(v);
+                return i + 1;
+            }
+        }
+        value = 0;
+        return 0;
+    }
+
 }//namespace rpc
 }// namespace bm
 
@@ -0,0 +1,137 @@
+/*
+ *
+ * Copyright 2022 Claudio Lanfranchi.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef BMRPCWORKERS_H
+#define BMRPCWORKERS_H
+
+#if SERVER_WORKERS > 0
+
+namespace bm
+{
+namespace rpc
+{
+    /**
+     * WorkerPool
+     * Server side: runs Skeleton::dispatch on SERVER_WORKERS threads.
+     * The server loop thread submits the received messages and collects the replies as they complete.
+     * Each worker owns the message of its job until it is completed: the pool is only
+     * acquired and released by the server loop thread.
+     * The notify hook is called by the worker after each completed job, to wake the server loop.
+     */
+
+    template <typename D>
+    class WorkerPool{
+    public:
+
+        using Notify = void (*)(void* context);
+
+        WorkerPool(MsgPool<D>& pool, Notify notify, void* context):
+                m_pool(pool),m_notify(notify),m_context(context),m_in_flight(0),m_stop(false){
+            for(auto& t: m_threads)
+                t = std::thread(&WorkerPool::run, this);
+        }
+
+        ~WorkerPool(){
+            {
+                std::lock_guard<std::mutex> lock(m_jobs_mutex);
+                m_stop = true;
+            }
+            m_jobs_cv.notify_all();
+            for(auto& t: m_threads)
+                t.join();
+        }
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        //Returns false when the job queue is full.
+        bool submit(Skeleton<D>* rpc, MsgHandle handle){
+            {
+                std::lock_guard<std::mutex> lock(m_jobs_mutex);
+                if(!m_jobs.push(Job{rpc, handle}))
+                    return false;
+            }
+            m_in_flight++;
+            m_jobs_cv.notify_one();
+            return true;
+        }
+
+        //Returns false when no reply is ready.
+        bool completed(Skeleton<D>*& rpc, MsgHandle& handle){
+            std::lock_guard<std::mutex> lock(m_done_mutex);
+            if(m_done.empty())
+                return false;
+            rpc = m_done.front().rpc;
+            handle = m_done.front().handle;
+            m_done.pop();
+            m_in_flight--;
+            return true;
+        }
+
+        //Jobs submitted and not yet collected
+        [[nodiscard]] INLINE size_t in_flight() const {
+            return m_in_flight;
+        }
+
+    private:
+
+        struct Job{
+            Skeleton<D>* rpc;
+            MsgHandle handle;
+        };
+
+        void run(){
+            while(true){
+                Job job{};
+                {
+                    std::unique_lock<std::mutex> lock(m_jobs_mutex);
+                    m_jobs_cv.wait(lock, [this]{ return m_stop || !m_jobs.empty(); });
+                    if(m_stop)
+                        return;
+                    job = m_jobs.front();
+                    m_jobs.pop();
+                }
+                job.rpc->dispatch(m_pool[job.handle]);
+                {
+                    std::lock_guard<std::mutex> lock(m_done_mutex);
+                    m_done.push(job);
+                }
+                m_notify(m_context);
+            }
+        }
+
+        MsgPool<D>& m_pool;
+        Notify m_notify;
+        void* m_context;
+        std::array<std::thread, SERVER_WORKERS> m_threads;
+        std::mutex m_jobs_mutex;
+        std::condition_variable m_jobs_cv;
+        FixedQueue<Job, MSG_POOL_SIZE> m_jobs;
+        std::mutex m_done_mutex;
+        FixedQueue<Job, MSG_POOL_SIZE> m_done;
+        size_t m_in_flight;//server loop thread only
+        bool m_stop;
+    };
+
+}//namespace rpc
+}//namespace bm
+
+#endif // SERVER_WORKERS > 0
+
+#endif // BMRPCWORKERS_H
@@ -97,9 +97,9 @@ int main() {
 
 #if BMRPC_CLIENT
 
-    client.ASYNC_RPC_WITH_CB(fsm, fsm_stub, [&](ReturnValue r) {
-        if (r.valid())
-            cout << "fsm errorno: " << r.get_value<int>() << endl;
+    client.ASYNC_RPC_WITH_CB(fsm, fsm_stub, [&](Result<int> r) {
+        if (r.ok())
+            cout << "fsm errorno: " << r.value() << endl;
         //implement callback logic
     }, state, (long)0xAA556432, sensor, error_description);
 